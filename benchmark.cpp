@@ -0,0 +1,351 @@
+// Benchmark program that renders procedurally generated scenes and reports timings
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "Transform.h"
+#include "scene.h"
+#include "renderer.h"
+#include "stats.h"
+
+using namespace std;
+
+// Every case is written in the scene file dialect, loaded through Scene::readFile and
+// rendered with the tile renderer. Each case runs in its own process, which also writes
+// the scene text, so that the peak resident memory reported is that of the case alone.
+struct BenchCase
+{
+  string name;
+  string (*generate)(int size, int width, int height);
+  int size;
+};
+
+typedef chrono::steady_clock Clock;
+
+double millisecondsSince(Clock::time_point start) {
+  return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+void writeHeader(ostringstream &out, int width, int height, int maxdepth, float distance) {
+  out << "size " << width << " " << height << "\n";
+  out << "maxdepth " << maxdepth << "\n";
+  out << "camera 0 " << distance * 0.3f << " " << distance << " 0 0 0 0 1 0 45\n";
+  out << "ambient 0.1 0.1 0.1\n";
+  out << "diffuse 0.6 0.5 0.4\n";
+  out << "specular 0.2 0.2 0.2\n";
+  out << "shininess 20\n";
+}
+
+// n x n spheres on a plane, two lights
+string sphereGrid(int n, int width, int height) {
+  ostringstream out;
+  writeHeader(out, width, height, 3, n * 1.5f);
+  out << "point 0 10 10 0.8 0.8 0.8\n";
+  out << "directional 1 1 1 0.3 0.3 0.3\n";
+  for (int x = 0; x < n; x++) {
+    for (int z = 0; z < n; z++) {
+      out << "sphere " << x - n / 2.0f << " 0 " << z - n / 2.0f << " 0.4\n";
+    }
+  }
+  return out.str();
+}
+
+// Vertices of a ball of the given radius at the origin, tessellated like mesh
+void writeBallVertices(ostringstream &out, int segments, float radius) {
+  const float pi = 3.14159265f;
+  out << "maxverts " << (segments + 1) * (segments + 1) << "\n";
+  for (int a = 0; a <= segments; a++) {
+    float theta = pi * a / segments;
+    for (int b = 0; b <= segments; b++) {
+      float phi = 2 * pi * b / segments;
+      out << "vertex " << radius * sin(theta) * cos(phi) << " " << radius * cos(theta) << " " << radius * sin(theta) * sin(phi) << "\n";
+    }
+  }
+}
+
+// 2 * segments * segments triangles over the vertices written by writeBallVertices
+void writeBallTriangles(ostringstream &out, int segments) {
+  for (int a = 0; a < segments; a++) {
+    for (int b = 0; b < segments; b++) {
+      int v0 = a * (segments + 1) + b, v1 = v0 + 1, v2 = v0 + segments + 1, v3 = v2 + 1;
+      out << "tri " << v0 << " " << v1 << " " << v2 << "\n";
+      out << "tri " << v1 << " " << v3 << " " << v2 << "\n";
+    }
+  }
+}
+
+// Unit sphere tessellated into 2 * segments * segments triangles with vertex and tri
+string mesh(int segments, int width, int height) {
+  ostringstream out;
+  writeHeader(out, width, height, 3, 4.0f);
+  out << "point 0 5 5 1 1 1\n";
+  writeBallVertices(out, segments, 1.0f);
+  writeBallTriangles(out, segments);
+  return out.str();
+}
+
+// A small sphere grid lit by a ring of point lights
+string manyLights(int lights, int width, int height) {
+  ostringstream out;
+  writeHeader(out, width, height, 3, 12.0f);
+  const float pi = 3.14159265f;
+  for (int k = 0; k < lights; k++) {
+    float angle = 2 * pi * k / lights;
+    out << "point " << 8 * cos(angle) << " 6 " << 8 * sin(angle) << " " << 2.0f / lights << " " << 2.0f / lights << " " << 2.0f / lights << "\n";
+  }
+  for (int x = 0; x < 8; x++) {
+    for (int z = 0; z < 8; z++) {
+      out << "sphere " << x - 4 << " 0 " << z - 4 << " 0.4\n";
+    }
+  }
+  return out.str();
+}
+
+// Two facing mirrors with spheres between them, so rays bounce until maxdepth
+string mirrors(int maxdepth, int width, int height) {
+  ostringstream out;
+  writeHeader(out, width, height, maxdepth, 6.0f);
+  out << "point 0 4 4 1 1 1\n";
+  out << "specular 0.9 0.9 0.9\n";
+  out << "maxverts 8\n";
+  out << "vertex -20 -20 -4\nvertex 20 -20 -4\nvertex 20 20 -4\nvertex -20 20 -4\n";
+  out << "vertex -20 -20 8\nvertex 20 -20 8\nvertex 20 20 8\nvertex -20 20 8\n";
+  out << "tri 0 1 2\ntri 0 2 3\ntri 4 6 5\ntri 4 7 6\n";
+  out << "specular 0.3 0.3 0.3\n";
+  for (int k = 0; k < 5; k++) {
+    out << "sphere " << k - 2 << " " << (k % 2) * 0.8f << " 0 0.45\n";
+  }
+  return out.str();
+}
+
+// One small tessellated sphere defined as an object and instanced count times on a grid
+string instanced(int count, int width, int height) {
+  ostringstream out;
+  int n = (int) ceil(sqrt((float) count));
+  writeHeader(out, width, height, 3, n * 1.5f);
+  out << "point 0 10 10 0.8 0.8 0.8\n";
+  const int segments = 16;
+  writeBallVertices(out, segments, 0.4f);
+  out << "beginObject ball\n";
+  writeBallTriangles(out, segments);
+  out << "endObject\n";
+  for (int k = 0; k < count; k++) {
+    out << "pushTransform\ntranslate " << k % n - n / 2.0f << " 0 " << k / n - n / 2.0f << "\n";
+    out << "rotate 0 1 0 " << k * 37 % 360 << "\ninstance ball\npopTransform\n";
+  }
+  return out.str();
+}
+
+// Position of ball k of count circling the origin after frame frames. Balls further
+// out move faster, so neighbours drift apart and the refitted BVH loosens over time.
+vec3 orbitPosition(int k, int count, int frame) {
+  const float pi = 3.14159265f;
+  float radius = 2.0f + 0.02f * count;
+  float angle = 2 * pi * k / count + 0.01f * (1 + k % 5) * frame;
+  float distance = radius * (1.0f + 0.1f * (k % 5));
+  return vec3(distance * cos(angle), 0.3f * (k % 7 - 3), distance * sin(angle));
+}
+
+// count tessellated balls, each placed under a transform of its own
+string orbit(int count, int width, int height) {
+  ostringstream out;
+  vec3 far = orbitPosition(4, count, 0);
+  writeHeader(out, width, height, 3, 2.5f * glm::length(far));
+  out << "point 0 10 10 0.8 0.8 0.8\n";
+  const int segments = 16;
+  writeBallVertices(out, segments, 0.4f);
+  for (int k = 0; k < count; k++) {
+    vec3 p = orbitPosition(k, count, 0);
+    out << "pushTransform\ntranslate " << p.x << " " << p.y << " " << p.z << "\n";
+    writeBallTriangles(out, segments);
+    out << "popTransform\n";
+  }
+  return out.str();
+}
+
+void runCase(const BenchCase &bench, int num_threads, int width, int height, BVH::Quality bvh_quality, Scene::Traversal traversal) {
+  string filename = string(P_tmpdir) + "/raybench_" + to_string(getpid()) + ".test";
+  {
+    ofstream file(filename.c_str());
+    file << bench.generate(bench.size, width, height);
+  }
+
+  // The two halves of readFile, timed apart: build covers baking as well as the BVH
+  Scene scene;
+  scene.bvh_quality = bvh_quality;
+  scene.build_threads = num_threads;
+  scene.traversal = traversal;
+  Clock::time_point start = Clock::now();
+  scene.parse(filename);
+  double parse_ms = millisecondsSince(start);
+  remove(filename.c_str());
+
+  start = Clock::now();
+  scene.finalize();
+  double build_ms = millisecondsSince(start);
+
+  Framebuffer framebuffer;
+  TileRenderer renderer(scene, num_threads);
+  start = Clock::now();
+  renderer.render(framebuffer);
+  double render_ms = millisecondsSince(start);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // Instanced primitives count once per instance, as if the scene had been flattened
+  size_t primitives = scene.primitives.size();
+  for (unsigned int k = 0; k < scene.instances.size(); k++) {
+    primitives += scene.objects[scene.instances[k].object].primitives.size();
+  }
+  double primary_rays = (double) scene.width * scene.height;
+  // All rays are only known when the counters are compiled in (make STATS=1)
+  char rays_per_second[16] = "n/a";
+  if (Stats::enabled()) {
+    Stats counted = Stats::total();
+    double rays = counted.primary_rays + counted.shadow_rays + counted.reflection_rays;
+    snprintf(rays_per_second, sizeof(rays_per_second), "%.3f", rays / render_ms / 1000.0);
+  }
+  printf("%-20s %9zu %10.2f %10.2f %10.2f %12.3f %10s %10.1f\n", bench.name.c_str(), primitives,
+         parse_ms, build_ms, render_ms, primary_rays / render_ms / 1000.0, rays_per_second, usage.ru_maxrss / 1024.0);
+  fflush(stdout);
+}
+
+// Loads an orbit case as an animated scene and moves every ball for frames frames,
+// timing the per frame refit against the full build. Renders the last frame.
+void runAnimation(const BenchCase &bench, int frames, int num_threads, int width, int height, BVH::Quality bvh_quality, Scene::Traversal traversal) {
+  string filename = string(P_tmpdir) + "/raybench_" + to_string(getpid()) + ".test";
+  {
+    ofstream file(filename.c_str());
+    file << bench.generate(bench.size, width, height);
+  }
+
+  Scene scene;
+  scene.bvh_quality = bvh_quality;
+  scene.build_threads = num_threads;
+  scene.traversal = traversal;
+  scene.animated = true;
+  scene.parse(filename);
+  remove(filename.c_str());
+
+  Clock::time_point start = Clock::now();
+  scene.finalize();
+  double build_ms = millisecondsSince(start);
+
+  // The orbit file places the balls in order, one transform each
+  double refit_ms = 0;
+  int rebuilds = 0;
+  for (int frame = 1; frame <= frames; frame++) {
+    start = Clock::now();
+    for (int k = 0; k < bench.size; k++) {
+      vec3 p = orbitPosition(k, bench.size, frame);
+      scene.setTransform(scene.animated_transforms[k], glm::transpose(Transform::translate(p.x, p.y, p.z)));
+    }
+    rebuilds += scene.refit();
+    refit_ms += millisecondsSince(start);
+  }
+
+  Framebuffer framebuffer;
+  TileRenderer renderer(scene, num_threads);
+  start = Clock::now();
+  renderer.render(framebuffer);
+  double render_ms = millisecondsSince(start);
+
+  printf("%-20s %9zu %10.2f %10.3f %10d %10.2f\n", bench.name.c_str(), scene.primitives.size(),
+         build_ms, refit_ms / frames, rebuilds, render_ms);
+  fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+  int num_threads = ThreadPool::defaultThreadCount();
+  int width = 320, height = 240;
+  BVH::Quality bvh_quality = BVH::sah;
+  Scene::Traversal traversal = Scene::binary;
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    if (arg == "--threads" && k + 1 < argc) {
+      num_threads = atoi(argv[++k]);
+    } else if (arg == "--size" && k + 2 < argc) {
+      width = atoi(argv[++k]);
+      height = atoi(argv[++k]);
+    } else if (arg == "--fast-build") {
+      bvh_quality = BVH::lbvh;
+    } else if (arg == "--wide-bvh") {
+#if defined(__AVX2__)
+      traversal = Scene::wide;
+#else
+      cerr << "--wide-bvh needs a build with make AVX2=1, using the binary BVH\n";
+#endif
+    } else {
+      cerr << "Usage: raybench [--threads n] [--size width height] [--fast-build] [--wide-bvh]\n";
+      exit(-1);
+    }
+  }
+
+  vector<BenchCase> cases;
+  for (int n = 10; n <= 80; n *= 2) {
+    BenchCase bench = {"spheres_" + to_string(n * n), sphereGrid, n};
+    cases.push_back(bench);
+  }
+  for (int segments = 16; segments <= 256; segments *= 4) {
+    BenchCase bench = {"mesh_" + to_string(2 * segments * segments), mesh, segments};
+    cases.push_back(bench);
+  }
+  for (int lights = 4; lights <= 64; lights *= 4) {
+    BenchCase bench = {"lights_" + to_string(lights), manyLights, lights};
+    cases.push_back(bench);
+  }
+  for (int maxdepth = 1; maxdepth <= 16; maxdepth *= 4) {
+    BenchCase bench = {"mirrors_depth_" + to_string(maxdepth), mirrors, maxdepth};
+    cases.push_back(bench);
+  }
+  for (int count = 100; count <= 6400; count *= 4) {
+    BenchCase bench = {"instances_" + to_string(count), instanced, count};
+    cases.push_back(bench);
+  }
+
+  printf("%-20s %9s %10s %10s %10s %12s %10s %10s\n", "case", "prims", "parse ms", "build ms", "render ms", "Mprimary/s", "Mrays/s", "peak MB");
+  for (unsigned int k = 0; k < cases.size(); k++) {
+    // Nothing may be left in the stdout buffer for the child to print again
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+      runCase(cases[k], num_threads, width, height, bvh_quality, traversal);
+      _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      cerr << cases[k].name << " failed\n";
+    }
+  }
+
+  // Animated scenes, loaded once and refitted every frame
+  const int frames = 100;
+  printf("\n%-20s %9s %10s %10s %10s %10s\n", "animation", "prims", "build ms", "refit ms", "rebuilds", "render ms");
+  for (int count = 16; count <= 256; count *= 4) {
+    BenchCase bench = {"orbit_" + to_string(count), orbit, count};
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+      runAnimation(bench, frames, num_threads, width, height, bvh_quality, traversal);
+      _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      cerr << bench.name << " failed\n";
+    }
+  }
+  return 0;
+}
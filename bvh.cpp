@@ -0,0 +1,602 @@
+// BVH cpp file that builds the bounding volume hierarchy over the scene primitives
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <algorithm>
+#include "bvh.h"
+
+namespace
+{
+	const int num_bins = 16;
+	// Relative cost of a ray-box test against a ray-primitive test in the SAH
+	const float traversal_cost = 1.0f;
+	const float intersection_cost = 1.0f;
+
+	// Nodes with more references than this are split on the calling thread with their
+	// loops spread over the pool, smaller ones are built as independent subtrees
+	const int subtree_size = 16384;
+	// Smallest range worth handing to another worker in a parallel loop
+	const int min_chunk_size = 4096;
+	// The linear BVH has no cost model to stop splitting early, so its leaves stay small
+	const int lbvh_leaf_size = 4;
+	const int morton_bits = 10;
+
+	struct Bins
+	{
+		AABB boxes[3][num_bins];
+		int counts[3][num_bins];
+		Bins() { std::fill(&counts[0][0], &counts[0][0] + 3 * num_bins, 0); }
+	};
+
+	int chunkCount(ThreadPool *pool, int count)
+	{
+		if(pool == NULL)
+		{
+			return 1;
+		}
+		return std::max(1, std::min(pool->size() * 4, count / min_chunk_size));
+	}
+
+	// Runs body(chunk, begin, end) over chunks of [begin, end), on the pool when there is more than one
+	void forEachChunk(ThreadPool *pool, int chunks, int begin, int end, const function<void(int, int, int)> &body)
+	{
+		long long count = end - begin;
+		auto run = [&](int chunk)
+		{
+			body(chunk, begin + (int)(count * chunk / chunks), begin + (int)(count * (chunk + 1) / chunks));
+		};
+		if(pool != NULL && chunks > 1)
+		{
+			pool->parallelFor(chunks, run);
+		}
+		else
+		{
+			for(int chunk = 0; chunk < chunks; ++chunk)
+			{
+				run(chunk);
+			}
+		}
+	}
+
+	// Clamped on both sides in float, so a centroid made non-finite by a degenerate
+	// transform lands in bin 0 instead of outside the bins
+	inline int binIndex(float centroid, float lo, float scale)
+	{
+		return (int)std::min(std::max(0.0f, (centroid - lo) * scale), (float)(num_bins - 1));
+	}
+
+	// Spreads the low 10 bits of v so that two zero bits follow each of them
+	inline unsigned int expandBits(unsigned int v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	// 30 bit Morton code of a point given relative to the centroid bounds in [0, 1]
+	inline unsigned int mortonCode(const vec3 &p)
+	{
+		const float cells = (float)(1 << morton_bits);
+		unsigned int x = (unsigned int)std::min(std::max(p.x * cells, 0.0f), cells - 1);
+		unsigned int y = (unsigned int)std::min(std::max(p.y * cells, 0.0f), cells - 1);
+		unsigned int z = (unsigned int)std::min(std::max(p.z * cells, 0.0f), cells - 1);
+		return (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+	}
+}
+
+void BVH::build(const vector<AABB> &bounds, Quality quality, ThreadPool *pool)
+{
+	nodes.clear();
+	indices.clear();
+	if(bounds.empty())
+	{
+		return;
+	}
+
+	int size = bounds.size();
+	vector<BuildRef> refs(size);
+	forEachChunk(pool, chunkCount(pool, size), 0, size, [&](int, int begin, int end)
+	{
+		for(int i = begin; i < end; ++i)
+		{
+			refs[i].box = bounds[i];
+			refs[i].centroid = refs[i].box.centroid();
+			refs[i].index = i;
+			refs[i].code = 0;
+		}
+	});
+	if(quality == lbvh)
+	{
+		sortByMortonCode(refs, pool);
+	}
+
+	// Split the top of the tree here until every remaining range is small enough to be
+	// built on its own. Interior boxes of this part are filled in once the subtrees exist.
+	nodes.reserve(2 * size);
+	nodes.push_back(Node());
+	vector<BuildTask> pending(1), tasks;
+	pending[0].node = 0;
+	pending[0].begin = 0;
+	pending[0].end = size;
+	pending[0].depth = 0;
+	vector<int> top;
+	while(!pending.empty())
+	{
+		BuildTask task = pending.back();
+		pending.pop_back();
+		if(pool == NULL || task.end - task.begin <= subtree_size || task.depth >= max_depth - 1)
+		{
+			tasks.push_back(task);
+			continue;
+		}
+
+		int mid;
+		if(quality == sah)
+		{
+			AABB box, centroid_box;
+			rangeBounds(refs, task.begin, task.end, pool, &box, &centroid_box);
+			mid = partition(refs, task.begin, task.end, centroid_box, findSplit(refs, task.begin, task.end, centroid_box, pool));
+		}
+		else
+		{
+			mid = mortonSplit(refs, task.begin, task.end);
+		}
+
+		int left = nodes.size();
+		nodes.push_back(Node());
+		nodes.push_back(Node());
+		nodes[task.node].first = left;
+		nodes[task.node].count = 0;
+		top.push_back(task.node);
+		BuildTask children[2] = {{left, task.begin, mid, task.depth + 1}, {left + 1, mid, task.end, task.depth + 1}};
+		pending.push_back(children[0]);
+		pending.push_back(children[1]);
+	}
+
+	vector<vector<Node> > subtrees(tasks.size());
+	auto buildSubtree = [&](int t)
+	{
+		subtrees[t].reserve(2 * (tasks[t].end - tasks[t].begin));
+		subtrees[t].push_back(Node());
+		if(quality == sah)
+		{
+			subdivide(subtrees[t], 0, refs, tasks[t].begin, tasks[t].end, tasks[t].depth);
+		}
+		else
+		{
+			emit(subtrees[t], 0, refs, tasks[t].begin, tasks[t].end, tasks[t].depth);
+		}
+	};
+	if(pool != NULL)
+	{
+		pool->parallelFor(tasks.size(), buildSubtree);
+	}
+	else
+	{
+		buildSubtree(0);
+	}
+
+	// Append every subtree behind the top nodes. Its root replaces the node reserved for
+	// it, the rest keep their order so interior nodes only need their child index moved.
+	for(unsigned int t = 0; t < tasks.size(); ++t)
+	{
+		const vector<Node> &subtree = subtrees[t];
+		int offset = nodes.size() - 1;
+		for(unsigned int k = 0; k < subtree.size(); ++k)
+		{
+			Node node = subtree[k];
+			if(!node.isLeaf())
+			{
+				node.first += offset;
+			}
+			if(k == 0)
+			{
+				nodes[tasks[t].node] = node;
+			}
+			else
+			{
+				nodes.push_back(node);
+			}
+		}
+		vector<Node>().swap(subtrees[t]);
+	}
+
+	// Top nodes were created parent first, so in reverse both children are final
+	for(int k = top.size() - 1; k >= 0; --k)
+	{
+		Node &node = nodes[top[k]];
+		node.box = nodes[node.first].box;
+		node.box.expand(nodes[node.first + 1].box);
+	}
+
+	indices.resize(size);
+	for(int i = 0; i < size; ++i)
+	{
+		indices[i] = refs[i].index;
+	}
+	// Sorted leaves keep each shape in one run when triangles are numbered before spheres
+	for(unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		if(nodes[i].isLeaf())
+		{
+			sort(indices.begin() + nodes[i].first, indices.begin() + nodes[i].first + nodes[i].count);
+		}
+	}
+}
+
+bool BVH::valid(size_t num_primitives) const
+{
+	for(unsigned int i = 0; i < indices.size(); ++i)
+	{
+		if(indices[i] < 0 || (size_t)indices[i] >= num_primitives)
+		{
+			return false;
+		}
+	}
+	// build numbers children after their parent, so one pass in order sees every parent
+	// before its children and a node reached twice or never is rejected
+	vector<int> depth(nodes.size(), -1);
+	if(!nodes.empty())
+	{
+		depth[0] = 0;
+	}
+	for(unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		const Node &node = nodes[i];
+		if(depth[i] < 0)
+		{
+			return false;
+		}
+		if(node.isLeaf())
+		{
+			if(node.first < 0 || (size_t)node.first + node.count > indices.size()
+				|| !is_sorted(indices.begin() + node.first, indices.begin() + node.first + node.count))
+			{
+				return false;
+			}
+			continue;
+		}
+		if(node.first <= (int)i || (size_t)node.first + 1 >= nodes.size() || depth[i] + 1 >= max_depth
+			|| depth[node.first] >= 0 || depth[node.first + 1] >= 0)
+		{
+			return false;
+		}
+		depth[node.first] = depth[node.first + 1] = depth[i] + 1;
+	}
+	return true;
+}
+
+void BVH::refit(const vector<AABB> &bounds)
+{
+	// Children always come after their parent, so in reverse both are final
+	for(int k = nodes.size() - 1; k >= 0; --k)
+	{
+		Node &node = nodes[k];
+		node.box = AABB();
+		if(node.isLeaf())
+		{
+			for(int i = node.first; i < node.first + node.count; ++i)
+			{
+				node.box.expand(bounds[indices[i]]);
+			}
+		}
+		else
+		{
+			node.box.expand(nodes[node.first].box);
+			node.box.expand(nodes[node.first + 1].box);
+		}
+	}
+}
+
+float BVH::cost() const
+{
+	if(nodes.empty())
+	{
+		return 0.0f;
+	}
+	float total = 0.0f;
+	for(unsigned int k = 0; k < nodes.size(); ++k)
+	{
+		const Node &node = nodes[k];
+		total += node.box.surfaceArea() * (node.isLeaf() ? intersection_cost * node.count : traversal_cost);
+	}
+	float root_area = nodes[0].box.surfaceArea();
+	return root_area > 0.0f ? total / root_area : total;
+}
+
+void BVH::rangeBounds(const vector<BuildRef> &refs, int begin, int end, ThreadPool *pool, AABB *box, AABB *centroid_box)
+{
+	int chunks = chunkCount(pool, end - begin);
+	if(chunks == 1)
+	{
+		for(int i = begin; i < end; ++i)
+		{
+			box->expand(refs[i].box);
+			centroid_box->expand(refs[i].centroid);
+		}
+		return;
+	}
+	vector<AABB> boxes(chunks), centroid_boxes(chunks);
+	forEachChunk(pool, chunks, begin, end, [&](int chunk, int chunk_begin, int chunk_end)
+	{
+		for(int i = chunk_begin; i < chunk_end; ++i)
+		{
+			boxes[chunk].expand(refs[i].box);
+			centroid_boxes[chunk].expand(refs[i].centroid);
+		}
+	});
+	for(int chunk = 0; chunk < chunks; ++chunk)
+	{
+		box->expand(boxes[chunk]);
+		centroid_box->expand(centroid_boxes[chunk]);
+	}
+}
+
+// Bins refs[begin, end) by centroid on every axis and returns the split between two bins
+// with the lowest SAH cost. axis is -1 when all centroids coincide.
+BVH::Split BVH::findSplit(const vector<BuildRef> &refs, int begin, int end, const AABB &centroid_box, ThreadPool *pool)
+{
+	vec3 extent = centroid_box.hi - centroid_box.lo;
+	vec3 scale;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		scale[axis] = extent[axis] > 0.0f ? num_bins / extent[axis] : 0.0f;
+	}
+
+	auto binRange = [&](Bins &bins, int chunk_begin, int chunk_end)
+	{
+		for(int i = chunk_begin; i < chunk_end; ++i)
+		{
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				if(extent[axis] <= 0.0f)
+				{
+					continue;
+				}
+				int b = binIndex(refs[i].centroid[axis], centroid_box.lo[axis], scale[axis]);
+				bins.boxes[axis][b].expand(refs[i].box);
+				++bins.counts[axis][b];
+			}
+		}
+	};
+
+	Bins bins;
+	int chunks = chunkCount(pool, end - begin);
+	if(chunks == 1)
+	{
+		binRange(bins, begin, end);
+	}
+	else
+	{
+		vector<Bins> chunk_bins(chunks);
+		forEachChunk(pool, chunks, begin, end, [&](int chunk, int chunk_begin, int chunk_end)
+		{
+			binRange(chunk_bins[chunk], chunk_begin, chunk_end);
+		});
+		for(int chunk = 0; chunk < chunks; ++chunk)
+		{
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				for(int b = 0; b < num_bins; ++b)
+				{
+					bins.boxes[axis][b].expand(chunk_bins[chunk].boxes[axis][b]);
+					bins.counts[axis][b] += chunk_bins[chunk].counts[axis][b];
+				}
+			}
+		}
+	}
+
+	Split best = {-1, 0, INFINITY};
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		if(extent[axis] <= 0.0f)
+		{
+			continue;
+		}
+
+		// Sweep from the right to get the cost of every right hand side, then from the left
+		float right_area[num_bins - 1];
+		int right_count[num_bins - 1];
+		AABB right_box;
+		int right_sum = 0;
+		for(int b = num_bins - 1; b > 0; --b)
+		{
+			right_box.expand(bins.boxes[axis][b]);
+			right_sum += bins.counts[axis][b];
+			right_area[b - 1] = right_box.surfaceArea();
+			right_count[b - 1] = right_sum;
+		}
+		AABB left_box;
+		int left_sum = 0;
+		for(int b = 0; b < num_bins - 1; ++b)
+		{
+			left_box.expand(bins.boxes[axis][b]);
+			left_sum += bins.counts[axis][b];
+			if(left_sum == 0 || right_count[b] == 0)
+			{
+				continue;
+			}
+			float cost = left_sum * left_box.surfaceArea() + right_count[b] * right_area[b];
+			if(cost < best.cost)
+			{
+				best.cost = cost;
+				best.axis = axis;
+				best.bin = b;
+			}
+		}
+	}
+	return best;
+}
+
+// Moves the references left of the split to the front and returns the first one to the
+// right of it. Splits in the middle when the split would leave one side empty.
+int BVH::partition(vector<BuildRef> &refs, int begin, int end, const AABB &centroid_box, const Split &split)
+{
+	int mid = (begin + end) / 2;
+	if(split.axis != -1)
+	{
+		int axis = split.axis;
+		float lo = centroid_box.lo[axis];
+		float scale = num_bins / (centroid_box.hi[axis] - lo);
+		BuildRef *pivot = std::partition(&refs[begin], &refs[0] + end, [&](const BuildRef &ref)
+		{
+			return binIndex(ref.centroid[axis], lo, scale) <= split.bin;
+		});
+		mid = pivot - &refs[0];
+	}
+	if(mid == begin || mid == end)
+	{
+		mid = (begin + end) / 2;
+	}
+	return mid;
+}
+
+// Splits refs[begin, end) with a binned surface area heuristic and recurses.
+// Falls back to a leaf when no split is cheaper than intersecting everything.
+void BVH::subdivide(vector<Node> &out, int node_index, vector<BuildRef> &refs, int begin, int end, int depth)
+{
+	AABB box, centroid_box;
+	rangeBounds(refs, begin, end, NULL, &box, &centroid_box);
+	out[node_index].box = box;
+	out[node_index].first = begin;
+	out[node_index].count = end - begin;
+
+	int count = end - begin;
+	if(count <= 1 || depth >= max_depth - 1)
+	{
+		return;
+	}
+
+	Split split = findSplit(refs, begin, end, centroid_box, NULL);
+	float leaf_cost = count * intersection_cost;
+	float area = box.surfaceArea();
+	if(split.axis == -1)
+	{
+		// All centroids coincide, only split if the leaf would be too large
+		if(count <= max_leaf_size)
+		{
+			return;
+		}
+	}
+	else if(area > 0.0f && count <= max_leaf_size && traversal_cost + intersection_cost * split.cost / area >= leaf_cost)
+	{
+		return;
+	}
+
+	int mid = partition(refs, begin, end, centroid_box, split);
+	int left = out.size();
+	out.push_back(Node());
+	out.push_back(Node());
+	out[node_index].first = left;
+	out[node_index].count = 0;
+	subdivide(out, left, refs, begin, mid, depth + 1);
+	subdivide(out, left + 1, refs, mid, end, depth + 1);
+}
+
+// Stable radix sort of the references by the Morton code of their centroid, 8 bits a
+// pass. Each chunk counts its digits, then scatters to offsets that follow every
+// earlier chunk, so the chunks need no synchronisation.
+void BVH::sortByMortonCode(vector<BuildRef> &refs, ThreadPool *pool)
+{
+	const int radix = 256;
+	int size = refs.size();
+	int chunks = chunkCount(pool, size);
+
+	AABB box, centroid_box;
+	rangeBounds(refs, 0, size, pool, &box, &centroid_box);
+	vec3 extent = centroid_box.hi - centroid_box.lo;
+	vec3 scale;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		scale[axis] = extent[axis] > 0.0f ? 1.0f / extent[axis] : 0.0f;
+	}
+	forEachChunk(pool, chunks, 0, size, [&](int, int begin, int end)
+	{
+		for(int i = begin; i < end; ++i)
+		{
+			refs[i].code = mortonCode((refs[i].centroid - centroid_box.lo) * scale);
+		}
+	});
+
+	vector<BuildRef> sorted(size);
+	vector<int> offsets(chunks * radix);
+	for(int shift = 0; shift < 32; shift += 8)
+	{
+		std::fill(offsets.begin(), offsets.end(), 0);
+		forEachChunk(pool, chunks, 0, size, [&](int chunk, int begin, int end)
+		{
+			int *counts = &offsets[chunk * radix];
+			for(int i = begin; i < end; ++i)
+			{
+				++counts[(refs[i].code >> shift) & (radix - 1)];
+			}
+		});
+		int sum = 0;
+		for(int digit = 0; digit < radix; ++digit)
+		{
+			for(int chunk = 0; chunk < chunks; ++chunk)
+			{
+				int count = offsets[chunk * radix + digit];
+				offsets[chunk * radix + digit] = sum;
+				sum += count;
+			}
+		}
+		forEachChunk(pool, chunks, 0, size, [&](int chunk, int begin, int end)
+		{
+			int *next = &offsets[chunk * radix];
+			for(int i = begin; i < end; ++i)
+			{
+				sorted[next[(refs[i].code >> shift) & (radix - 1)]++] = refs[i];
+			}
+		});
+		refs.swap(sorted);
+	}
+}
+
+// Splits a range sorted by Morton code at the first reference whose highest differing
+// bit is set. Ranges of equal codes are split in the middle.
+int BVH::mortonSplit(const vector<BuildRef> &refs, int begin, int end)
+{
+	unsigned int first = refs[begin].code, last = refs[end - 1].code;
+	if(first == last)
+	{
+		return (begin + end) / 2;
+	}
+	unsigned int bit = 1u << (31 - __builtin_clz(first ^ last));
+	const BuildRef *pivot = std::partition_point(&refs[begin], &refs[0] + end, [bit](const BuildRef &ref)
+	{
+		return (ref.code & bit) == 0;
+	});
+	return pivot - &refs[0];
+}
+
+// Builds the linear BVH below node_index top down. Boxes are merged on the way back up
+// since the split does not need them.
+void BVH::emit(vector<Node> &out, int node_index, const vector<BuildRef> &refs, int begin, int end, int depth)
+{
+	if(end - begin <= lbvh_leaf_size || depth >= max_depth - 1)
+	{
+		AABB box;
+		for(int i = begin; i < end; ++i)
+		{
+			box.expand(refs[i].box);
+		}
+		out[node_index].box = box;
+		out[node_index].first = begin;
+		out[node_index].count = end - begin;
+		return;
+	}
+
+	int mid = mortonSplit(refs, begin, end);
+	int left = out.size();
+	out.push_back(Node());
+	out.push_back(Node());
+	emit(out, left, refs, begin, mid, depth + 1);
+	emit(out, left + 1, refs, mid, end, depth + 1);
+	out[node_index].box = out[left].box;
+	out[node_index].box.expand(out[left + 1].box);
+	out[node_index].first = left;
+	out[node_index].count = 0;
+}
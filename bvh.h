@@ -0,0 +1,90 @@
+// BVH header file that declares the bounding volume hierarchy over the scene primitives
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include "primitives.h"
+#include "threadpool.h"
+
+using namespace std;
+
+class BVH
+{
+public:
+	// Flattened node. Interior nodes store their two children at first and first + 1,
+	// leaves store count primitive references starting at indices[first], in
+	// ascending order.
+	struct Node
+	{
+		AABB box;
+		int first;
+		int count;
+		bool isLeaf() const { return count > 0; }
+	};
+
+	// sah splits with a binned surface area heuristic, for final renders. lbvh sorts the
+	// primitives along a Morton curve and splits on its bits, which builds several times
+	// faster at some cost in traversal speed, for previews.
+	enum Quality {sah, lbvh};
+
+	static const int max_leaf_size = 8; // One full packet for the 8 wide triangle kernel
+	static const int max_depth = 64;
+
+	// Nodes are kept in the order the build emits them. Reordering them depth first and
+	// backing them with huge pages traced no faster on the raybench scenes.
+	vector<Node> nodes;
+	vector<int> indices;
+
+	// Builds over the world space bounds of every primitive. With a pool the top of the
+	// tree is split with its loops spread over the workers and the subtrees below it are
+	// built in parallel.
+	void build(const vector<AABB> &bounds, Quality quality = sah, ThreadPool *pool = NULL);
+	bool empty() const { return nodes.empty(); }
+	// False unless the nodes form a tree no deeper than max_depth whose leaves list
+	// sorted references below num_primitives, for hierarchies not built here
+	bool valid(size_t num_primitives) const;
+
+	// Recomputes every node box bottom-up from new primitive bounds, keeping the tree.
+	// Cheap enough to run per frame, but the tree degrades as primitives move apart.
+	void refit(const vector<AABB> &bounds);
+
+	// Expected cost of a random ray under the surface area heuristic, relative to one
+	// primitive test. Compare it before and after refits to decide on a rebuild.
+	float cost() const;
+
+private:
+	struct BuildRef
+	{
+		AABB box;
+		vec3 centroid;
+		int index;
+		unsigned int code;
+	};
+
+	struct BuildTask
+	{
+		int node;
+		int begin, end;
+		int depth;
+	};
+
+	struct Split
+	{
+		int axis;
+		int bin;
+		float cost;
+	};
+
+	static void rangeBounds(const vector<BuildRef> &refs, int begin, int end, ThreadPool *pool, AABB *box, AABB *centroid_box);
+	static Split findSplit(const vector<BuildRef> &refs, int begin, int end, const AABB &centroid_box, ThreadPool *pool);
+	static int partition(vector<BuildRef> &refs, int begin, int end, const AABB &centroid_box, const Split &split);
+	static void sortByMortonCode(vector<BuildRef> &refs, ThreadPool *pool);
+	static int mortonSplit(const vector<BuildRef> &refs, int begin, int end);
+
+	static void subdivide(vector<Node> &out, int node_index, vector<BuildRef> &refs, int begin, int end, int depth);
+	static void emit(vector<Node> &out, int node_index, const vector<BuildRef> &refs, int begin, int end, int depth);
+};
+
+#endif
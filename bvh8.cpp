@@ -0,0 +1,170 @@
+// BVH8 cpp file that collapses a binary BVH into the 8 wide quantized BVH
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <algorithm>
+#include "bvh8.h"
+
+namespace
+{
+	const int max_plane = 255;
+	// Stands in for the inverse of a zero direction component
+	const float huge_inverse = 1e30f;
+
+	// Sets the grid of node to the smallest power of two steps that span box in max_plane steps
+	void placeGrid(BVH8::Node &node, const AABB &box)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			int exponent;
+			frexp((box.hi[axis] - box.lo[axis]) / max_plane, &exponent);
+			node.origin[axis] = box.lo[axis];
+			node.scale[axis] = ldexp(1.0f, exponent);
+		}
+	}
+
+	void quantizeChild(BVH8::Node &node, int k, const AABB &box)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			float origin = node.origin[axis], scale = node.scale[axis];
+			int lo = std::min(std::max((int)floor((box.lo[axis] - origin) / scale), 0), max_plane);
+			int hi = std::min(std::max((int)ceil((box.hi[axis] - origin) / scale), 0), max_plane);
+			// The divisions round, step outwards until the planes really enclose the child
+			while(lo > 0 && origin + lo * scale > box.lo[axis])
+			{
+				--lo;
+			}
+			while(hi < max_plane && origin + hi * scale < box.hi[axis])
+			{
+				++hi;
+			}
+			node.lo[axis][k] = lo;
+			node.hi[axis][k] = hi;
+		}
+	}
+}
+
+BVH8::TraversalRay::TraversalRay(const Ray &ray)
+{
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		float d = ray.direction[axis];
+		o[axis] = ray.o[axis];
+		inv_dir[axis] = fabs(d) > 1e-30f ? 1.0f / d : (std::signbit(d) ? -huge_inverse : huge_inverse);
+		negative[axis] = inv_dir[axis] < 0.0f;
+	}
+}
+
+void BVH8::build(const BVH &bvh)
+{
+	nodes.clear();
+	sources.clear();
+	if(bvh.empty())
+	{
+		return;
+	}
+	nodes.reserve(bvh.nodes.size() / 4 + 1);
+	nodes.push_back(Node());
+	sources.push_back(Source());
+	collapse(bvh, 0, 0);
+}
+
+void BVH8::refit(const BVH &bvh)
+{
+	for(unsigned int k = 0; k < nodes.size(); ++k)
+	{
+		const Source &source = sources[k];
+		placeGrid(nodes[k], bvh.nodes[source.node].box);
+		for(int child = 0; child < width && source.children[child] >= 0; ++child)
+		{
+			quantizeChild(nodes[k], child, bvh.nodes[source.children[child]].box);
+		}
+	}
+}
+
+// Fills nodes[node_index] from the binary node binary_index. Its largest interior
+// descendants are opened until there are eight children or only leaves are left,
+// then every interior child is collapsed the same way.
+void BVH8::collapse(const BVH &bvh, int node_index, int binary_index)
+{
+	const BVH::Node &binary = bvh.nodes[binary_index];
+	int children[width];
+	int num_children = 0;
+	if(binary.isLeaf())
+	{
+		children[num_children++] = binary_index;
+	}
+	else
+	{
+		children[num_children++] = binary.first;
+		children[num_children++] = binary.first + 1;
+	}
+	while(num_children < width)
+	{
+		int largest = -1;
+		float largest_area = -1.0f;
+		for(int k = 0; k < num_children; ++k)
+		{
+			const BVH::Node &child = bvh.nodes[children[k]];
+			if(!child.isLeaf() && child.box.surfaceArea() > largest_area)
+			{
+				largest = k;
+				largest_area = child.box.surfaceArea();
+			}
+		}
+		if(largest < 0)
+		{
+			break;
+		}
+		int opened = children[largest];
+		children[largest] = bvh.nodes[opened].first;
+		children[num_children++] = bvh.nodes[opened].first + 1;
+	}
+
+	Node node;
+	Source source;
+	source.node = binary_index;
+	placeGrid(node, binary.box);
+	for(int k = 0; k < width; ++k)
+	{
+		if(k >= num_children)
+		{
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				node.lo[axis][k] = max_plane;
+				node.hi[axis][k] = 0;
+			}
+			node.child[k] = 0;
+			node.count[k] = 0;
+			source.children[k] = -1;
+			continue;
+		}
+
+		const BVH::Node &child = bvh.nodes[children[k]];
+		quantizeChild(node, k, child.box);
+		source.children[k] = children[k];
+		if(child.isLeaf())
+		{
+			node.child[k] = child.first;
+			node.count[k] = child.count;
+		}
+		else
+		{
+			node.child[k] = nodes.size();
+			node.count[k] = 0;
+			nodes.push_back(Node());
+			sources.push_back(Source());
+		}
+	}
+	nodes[node_index] = node;
+	sources[node_index] = source;
+
+	for(int k = 0; k < num_children; ++k)
+	{
+		if(node.count[k] == 0)
+		{
+			collapse(bvh, node.child[k], children[k]);
+		}
+	}
+}
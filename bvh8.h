@@ -0,0 +1,131 @@
+// BVH8 header file that declares the 8 wide BVH with quantized child bounds
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef BVH8_H
+#define BVH8_H
+
+#include <vector>
+#include <cmath>
+#include "primitives.h"
+#include "bvh.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Collapsed form of a binary BVH where every node holds up to eight children. Child
+// boxes are stored as 8 bit offsets on a grid spanning the node's own box, so one node
+// of 136 bytes replaces up to seven binary nodes of 32. Leaves keep the primitive
+// slots of the binary BVH, so its indices and the triangle buffer are shared.
+class BVH8
+{
+public:
+	static const int width = 8;
+
+	struct Node
+	{
+		// Child planes are origin + q * scale on each axis. The scales are powers of two
+		// and the planes are rounded outwards, so the quantized boxes enclose the real ones.
+		float origin[3];
+		float scale[3];
+		// Empty slots have lo above hi and are never hit
+		unsigned char lo[3][width];
+		unsigned char hi[3][width];
+		// Node index of an interior child, first primitive slot of a leaf child
+		int child[width];
+		// Primitive count of a leaf child, 0 for interior children
+		int count[width];
+	};
+
+	// Per ray constants of the box test. Zero direction components get a huge finite
+	// inverse so that no 0 * inf products appear.
+	struct TraversalRay
+	{
+		float o[3];
+		float inv_dir[3];
+		int negative[3];
+		TraversalRay(const Ray &ray);
+	};
+
+	vector<Node> nodes;
+
+	void build(const BVH &bvh);
+	bool empty() const { return nodes.empty(); }
+
+	// Quantizes the boxes again after bvh, the BVH this was built from, was refitted.
+	// The tree keeps its shape.
+	void refit(const BVH &bvh);
+
+	// Children of node whose quantized box the ray enters between 0 and t_max, as bits.
+	// t_near receives the entry parameter of every child.
+	static int intersectChildren(const Node &node, const TraversalRay &ray, float t_max, float *t_near);
+
+private:
+	// Binary nodes each node and its children were collapsed from, -1 for empty slots
+	struct Source
+	{
+		int node;
+		int children[width];
+	};
+	vector<Source> sources;
+
+	void collapse(const BVH &bvh, int node_index, int binary_index);
+};
+
+#if defined(__AVX2__)
+
+// Eight slab tests at once: the quantized planes are widened to floats and turned into
+// ray parameters with one multiply and add per plane
+inline int BVH8::intersectChildren(const Node &node, const TraversalRay &ray, float t_max, float *t_near)
+{
+	__m256 enter = _mm256_setzero_ps();
+	__m256 exit = _mm256_set1_ps(t_max);
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		const unsigned char *near_planes = ray.negative[axis] ? node.hi[axis] : node.lo[axis];
+		const unsigned char *far_planes = ray.negative[axis] ? node.lo[axis] : node.hi[axis];
+		__m256 q_near = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(near_planes))));
+		__m256 q_far = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(far_planes))));
+		__m256 step = _mm256_set1_ps(node.scale[axis] * ray.inv_dir[axis]);
+		__m256 base = _mm256_set1_ps((node.origin[axis] - ray.o[axis]) * ray.inv_dir[axis]);
+		enter = _mm256_max_ps(enter, _mm256_add_ps(_mm256_mul_ps(q_near, step), base));
+		exit = _mm256_min_ps(exit, _mm256_add_ps(_mm256_mul_ps(q_far, step), base));
+	}
+	_mm256_storeu_ps(t_near, enter);
+	return _mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ));
+}
+
+#else
+
+// The same math one child at a time. Eight scalar slab tests per node cost more than
+// the binary walk saves, so raytrace and raybench only offer --wide-bvh under AVX2.
+inline int BVH8::intersectChildren(const Node &node, const TraversalRay &ray, float t_max, float *t_near)
+{
+	float step[3], base[3];
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		step[axis] = node.scale[axis] * ray.inv_dir[axis];
+		base[axis] = (node.origin[axis] - ray.o[axis]) * ray.inv_dir[axis];
+	}
+	int hits = 0;
+	for(int k = 0; k < width; ++k)
+	{
+		float enter = 0.0f, exit = t_max;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			unsigned char near_plane = ray.negative[axis] ? node.hi[axis][k] : node.lo[axis][k];
+			unsigned char far_plane = ray.negative[axis] ? node.lo[axis][k] : node.hi[axis][k];
+			enter = std::max(enter, near_plane * step[axis] + base[axis]);
+			exit = std::min(exit, far_plane * step[axis] + base[axis]);
+		}
+		t_near[k] = enter;
+		hits |= (enter <= exit) << k;
+	}
+	return hits;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+// Camera cpp file that defines the precomputed camera model
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <cmath>
+#include "camera.h"
+
+// Same mapping as the per pixel formula it replaces:
+// a = tan(fovx / 2) * (j - width / 2) / (width / 2)
+// b = tan(fovy / 2) * (height / 2 - i) / (height / 2)
+// direction = -w + u * a + v * b
+CameraModel::CameraModel(const Camera &camera, int width_, int height_) : eye(camera.eye), width(width_), height(height_)
+{
+	vec3 w = glm::normalize(camera.eye - camera.center);
+	vec3 u = glm::normalize(glm::cross(camera.up, w));
+	vec3 v = glm::cross(w, u);
+
+	float tan_half_fovy = tan(glm::radians(camera.fovy) / 2.0f);
+	float tan_half_fovx = tan_half_fovy * width / height;
+	corner = -w - u * tan_half_fovx + v * tan_half_fovy;
+	column_step = u * (2.0f * tan_half_fovx / width);
+	row_step = v * (-2.0f * tan_half_fovy / height);
+}
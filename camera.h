@@ -0,0 +1,31 @@
+// Camera header file that declares the precomputed camera model used for ray generation
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "scene.h"
+
+// Camera basis and field of view folded into a corner direction and per pixel steps,
+// built once per frame. The direction through pixel (i, j) is then
+// corner + row_step * i + column_step * j, and walking a scanline is one add per pixel.
+class CameraModel
+{
+public:
+	CameraModel(const Camera &camera, int width_, int height_);
+
+	Ray ray(int i, int j) const { return Ray(eye, rowStart(i) + column_step * (float)j); }
+
+	// Ray through image plane position (y, x) in pixel units, used for sub pixel samples
+	Ray ray(float y, float x) const { return Ray(eye, corner + row_step * y + column_step * x); }
+
+	// Direction through the first pixel of row i
+	vec3 rowStart(int i) const { return corner + row_step * (float)i; }
+
+	vec3 eye;
+	vec3 corner;
+	vec3 row_step, column_step;
+	int width, height;
+};
+
+#endif
@@ -0,0 +1,14 @@
+// Framebuffer cpp file that defines the image the renderer writes into
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <algorithm>
+#include "framebuffer.h"
+
+void Framebuffer::writeTile(const Tile &tile, const vector<Color> &tile_pixels)
+{
+	for(int i = tile.y0; i < tile.y1; ++i)
+	{
+		std::copy(tile_pixels.begin() + tile.index(i, tile.x0), tile_pixels.begin() + tile.index(i, tile.x0) + tile.width(), pixels.begin() + i * width + tile.x0);
+	}
+}
@@ -0,0 +1,41 @@
+// Framebuffer header file that declares the image the renderer writes into
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <vector>
+#include "primitives.h"
+
+using namespace std;
+
+// Pixel rectangle [x0, x1) x [y0, y1) of the image
+struct Tile
+{
+	int x0, y0, x1, y1;
+
+	int width() const { return x1 - x0; }
+	int height() const { return y1 - y0; }
+
+	// Index of image pixel (i, j) in a row major buffer covering just this tile
+	int index(int i, int j) const { return (i - y0) * (x1 - x0) + (j - x0); }
+};
+
+// Row major float RGB image with row 0 at the top. Render threads fill tiles in a local
+// buffer and copy them in with writeTile, tiles never overlap so no locking is needed.
+class Framebuffer
+{
+public:
+	Framebuffer() : width(0), height(0) {}
+	Framebuffer(int width_, int height_) : width(width_), height(height_), pixels(width_ * height_, BLACK) {}
+
+	void writeTile(const Tile &tile, const vector<Color> &tile_pixels);
+
+	Color &at(int i, int j) { return pixels[i * width + j]; }
+	const Color &at(int i, int j) const { return pixels[i * width + j]; }
+
+	int width, height;
+	vector<Color> pixels;
+};
+
+#endif
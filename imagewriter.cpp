@@ -0,0 +1,99 @@
+// Image writer cpp file that defines the asynchronous FreeImage encoder
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <iostream>
+#include <FreeImage.h>
+#include "imagewriter.h"
+
+ImageWriter::ImageWriter(const ToneMapping &tone_mapping_) : tone_mapping(tone_mapping_), stopping(false)
+{
+	worker = thread(&ImageWriter::run, this);
+}
+
+ImageWriter::~ImageWriter()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+void ImageWriter::write(const Framebuffer &framebuffer, const string &filename)
+{
+	Job job = {framebuffer, filename};
+	{
+		lock_guard<mutex> guard(lock);
+		jobs.push_back(job);
+	}
+	wake.notify_one();
+}
+
+// Remaining jobs are still written after stopping is set, so nothing queued is lost
+void ImageWriter::run()
+{
+	unique_lock<mutex> guard(lock);
+	while(true)
+	{
+		wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+		if(jobs.empty())
+		{
+			return;
+		}
+		Job job = jobs.front();
+		jobs.pop_front();
+		guard.unlock();
+		save(job.framebuffer, job.filename, tone_mapping);
+		guard.lock();
+	}
+}
+
+bool ImageWriter::save(const Framebuffer &framebuffer, const string &filename, const ToneMapping &tone_mapping)
+{
+	int width = framebuffer.width, height = framebuffer.height;
+	FREE_IMAGE_FORMAT format = FreeImage_GetFIFFromFilename(filename.c_str());
+	FIBITMAP *img;
+	if(format == FIF_EXR || format == FIF_HDR)
+	{
+		// FreeImage scanlines run bottom up
+		img = FreeImage_AllocateT(FIT_RGBF, width, height);
+		for(int i = 0; i < height; ++i)
+		{
+			FIRGBF *scanline = reinterpret_cast<FIRGBF*>(FreeImage_GetScanLine(img, height - 1 - i));
+			for(int j = 0; j < width; ++j)
+			{
+				const Color &color = framebuffer.at(i, j);
+				scanline[j].red = color.r;
+				scanline[j].green = color.g;
+				scanline[j].blue = color.b;
+			}
+		}
+	}
+	else
+	{
+		// FreeImage expects BGR byte order for 24 bit images
+		if(format == FIF_UNKNOWN)
+		{
+			format = FIF_PNG;
+		}
+		Framebuffer display = tone_mapping.apply(framebuffer);
+		vector<BYTE> bytes(3 * width * height);
+		for(int k = 0; k < width * height; ++k)
+		{
+			bytes[3 * k] = display.pixels[k].Bbyte();
+			bytes[3 * k + 1] = display.pixels[k].Gbyte();
+			bytes[3 * k + 2] = display.pixels[k].Rbyte();
+		}
+		img = FreeImage_ConvertFromRawBits(bytes.data(), width, height, width * 3, 24, 0xFF0000, 0x00FF00, 0x0000FF, true);
+	}
+	cout << "Saving screenshot: " << filename << "\n";
+	bool saved = FreeImage_Save(format, img, filename.c_str(), 0);
+	FreeImage_Unload(img);
+	if(!saved)
+	{
+		cerr << "Failed writing image " << filename << "\n";
+	}
+	return saved;
+}
@@ -0,0 +1,51 @@
+// Image writer header file that declares the asynchronous FreeImage encoder
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "framebuffer.h"
+#include "tonemap.h"
+
+using namespace std;
+
+// Encodes framebuffers on a background thread so that the next frame or pass can render
+// while the previous one is written. The format follows the file extension: .exr and
+// .hdr keep the radiance as 32 bit float RGB, anything else is tone mapped and written
+// as 24 bit, PNG when the extension is not recognised. FreeImage must be initialised
+// for the lifetime of the writer.
+class ImageWriter
+{
+public:
+	explicit ImageWriter(const ToneMapping &tone_mapping_ = ToneMapping());
+	~ImageWriter();
+
+	// Queues a copy of framebuffer and returns without waiting for the encode
+	void write(const Framebuffer &framebuffer, const string &filename);
+
+	// Synchronous encode, used by the writer thread
+	static bool save(const Framebuffer &framebuffer, const string &filename, const ToneMapping &tone_mapping);
+
+private:
+	struct Job
+	{
+		Framebuffer framebuffer;
+		string filename;
+	};
+
+	void run();
+
+	ToneMapping tone_mapping;
+	deque<Job> jobs;
+	mutex lock;
+	condition_variable wake;
+	bool stopping;
+	thread worker;
+};
+
+#endif
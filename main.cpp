@@ -11,17 +11,78 @@
 #include "Transform.h"
 #include <FreeImage.h>
 #include <stdio.h>
+#include <cmath>
 #include <cassert>
 
 #include "scene.h"
+#include "renderer.h"
+#include "imagewriter.h"
+#include "stats.h"
 
 using namespace std;
  
-
 int main(int argc, char* argv[]) {
 
-  if (argc < 2) {
-    cerr << "Usage: raytrace scenefile \n"; 
+  int num_threads = ThreadPool::defaultThreadCount();
+  const char *scenefile = NULL;
+  const char *compiledfile = NULL;
+  TileRenderer::Mode mode = TileRenderer::scalar;
+  float min_throughput = -1;
+  BVH::Quality bvh_quality = BVH::sah;
+  Scene::Traversal traversal = Scene::binary;
+  const char *antialias[3] = {NULL, NULL, NULL};
+  double budget = -1;
+  const char *hdrfile = NULL;
+  ToneMapping tone_mapping;
+  bool stats = false;
+  const char *statsfile = NULL;
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    if (arg == "--threads" && k + 1 < argc) {
+      num_threads = atoi(argv[++k]);
+    } else if (arg == "--compile" && k + 1 < argc) {
+      compiledfile = argv[++k];
+    } else if (arg == "--packets") {
+      mode = TileRenderer::packets;
+    } else if (arg == "--wavefront") {
+#if defined(RT_WAVEFRONT)
+      mode = TileRenderer::wavefront;
+#else
+      cerr << "--wavefront needs a build with make WAVEFRONT=1, tracing with the scalar path\n";
+#endif
+    } else if (arg == "--min-throughput" && k + 1 < argc) {
+      min_throughput = atof(argv[++k]);
+    } else if (arg == "--fast-build") {
+      bvh_quality = BVH::lbvh;
+    } else if (arg == "--wide-bvh") {
+#if defined(__AVX2__)
+      traversal = Scene::wide;
+#else
+      cerr << "--wide-bvh needs a build with make AVX2=1, tracing the binary BVH\n";
+#endif
+    } else if (arg == "--hdr" && k + 1 < argc) {
+      hdrfile = argv[++k];
+    } else if (arg == "--exposure" && k + 1 < argc) {
+      tone_mapping.exposure = atof(argv[++k]);
+    } else if (arg == "--tonemap" && k + 1 < argc) {
+      tone_mapping.op = string(argv[++k]) == "reinhard" ? ToneMapping::reinhard : ToneMapping::clamp;
+    } else if (arg == "--stats") {
+      stats = true;
+    } else if (arg == "--stats-json" && k + 1 < argc) {
+      statsfile = argv[++k];
+    } else if (arg == "--progressive" && k + 1 < argc) {
+      budget = atof(argv[++k]);
+    } else if (arg == "--antialias" && k + 3 < argc) {
+      antialias[0] = argv[++k];
+      antialias[1] = argv[++k];
+      antialias[2] = argv[++k];
+    } else {
+      scenefile = argv[k];
+    }
+  }
+
+  if (scenefile == NULL) {
+    cerr << "Usage: raytrace [--threads n] [--compile compiledfile] [--packets | --wavefront] [--fast-build] [--wide-bvh] [--antialias base max threshold] [--progressive seconds] [--hdr file.exr|file.hdr] [--exposure stops] [--tonemap clamp|reinhard] [--min-throughput weight] [--stats] [--stats-json file] scenefile \n"; 
     exit(-1); 
   }
 
@@ -29,7 +90,68 @@ int main(int argc, char* argv[]) {
 
   Scene scene;
   scene.outputfile = "result.png";
-  scene.readfile(argv[1]); 
+  scene.bvh_quality = bvh_quality;
+  scene.build_threads = num_threads;
+  scene.traversal = traversal;
+  // Compiled scenes load without parsing, anything else is read as a text scene
+  if (!scene.readCompiled(scenefile)) {
+    scene.readFile(scenefile); 
+  }
+
+  // Command line sampling settings override the ones in the scene file
+  if (antialias[0] != NULL) {
+    scene.antialiasing.base_samples = max(atoi(antialias[0]), 1);
+    scene.antialiasing.max_samples = max(atoi(antialias[1]), scene.antialiasing.base_samples);
+    scene.antialiasing.threshold = atof(antialias[2]);
+  }
+
+  if (compiledfile != NULL) {
+    scene.writeCompiled(compiledfile);
+    FreeImage_DeInitialise();
+    return 0;
+  }
+
+  // By default a reflection stops once the next hit could add less than one 8 bit step
+  // to the pixel, however bright the scene's lights and materials are. Exposure scales
+  // the radiance before tone mapping, so the step shrinks with it, and an HDR copy keeps
+  // every reflection up to max_depth.
+  if (min_throughput >= 0) {
+    scene.min_throughput = min_throughput;
+  } else if (hdrfile != NULL) {
+    scene.min_throughput = 0;
+  } else {
+    scene.min_throughput = 1.0f / 256.0f / (exp2(tone_mapping.exposure) * scene.maxRadiance());
+  }
+
+  {
+    // The writer encodes in the background and finishes queued images before it is destroyed
+    // The radiance goes to the HDR file untouched, the scene output is tone mapped
+    ImageWriter writer(tone_mapping);
+    Framebuffer framebuffer;
+    TileRenderer renderer(scene, num_threads, mode);
+    auto output = [&](const Framebuffer &image) {
+      writer.write(image, scene.outputfile);
+      if (hdrfile != NULL) {
+        writer.write(image, hdrfile);
+      }
+    };
+    if (budget >= 0) {
+      // Each pass overwrites the output so the latest refinement is always on disk
+      renderer.renderProgressive(framebuffer, budget, output);
+    } else {
+      renderer.render(framebuffer);
+      output(framebuffer);
+    }
+  }
+
+  // Counters need a build with make STATS=1
+  if (stats) {
+    Stats::report(cout, false);
+  }
+  if (statsfile != NULL) {
+    ofstream out(statsfile);
+    Stats::report(out, true);
+  }
 
   FreeImage_DeInitialise();
 
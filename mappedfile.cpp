@@ -0,0 +1,57 @@
+// Mapped file cpp file that defines a read-only memory mapped file
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mappedfile.h"
+
+MappedFile::MappedFile() : begin(nullptr), length(0) {}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const string &filename)
+{
+	close();
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	// An empty file is valid but cannot be mapped
+	if(info.st_size > 0)
+	{
+		void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(address == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+		madvise(address, info.st_size, MADV_SEQUENTIAL);
+		begin = static_cast<const char*>(address);
+		length = info.st_size;
+	}
+	::close(fd);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(begin != nullptr)
+	{
+		munmap(const_cast<char*>(begin), length);
+	}
+	begin = nullptr;
+	length = 0;
+}
@@ -0,0 +1,32 @@
+// Mapped file header file that declares a read-only memory mapped file
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const string &filename);
+	void close();
+
+	const char *data() const { return begin; }
+	size_t size() const { return length; }
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator = (const MappedFile &);
+
+	const char *begin;
+	size_t length;
+};
+
+#endif
@@ -0,0 +1,182 @@
+// Ray packet cpp file that defines primary ray packet generation and packet traversal
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <cmath>
+#include <limits>
+#include "raytracer.h"
+
+namespace
+{
+	const float no_hit = std::numeric_limits<float>::infinity();
+
+	// Lanes of the packet that enter the box before their current nearest hit, as bits
+	inline int intersectBox(const AABB &box, const float4 *o, const float4 *inv_dir, float4 t_max, mask4 active, float4 *t_near)
+	{
+		float4 t0x = (set1(box.lo.x) - o[0]) * inv_dir[0], t1x = (set1(box.hi.x) - o[0]) * inv_dir[0];
+		float4 t0y = (set1(box.lo.y) - o[1]) * inv_dir[1], t1y = (set1(box.hi.y) - o[1]) * inv_dir[1];
+		float4 t0z = (set1(box.lo.z) - o[2]) * inv_dir[2], t1z = (set1(box.hi.z) - o[2]) * inv_dir[2];
+		float4 enter = max4(max4(min4(t0x, t1x), min4(t0y, t1y)), max4(min4(t0z, t1z), set1(0.0f)));
+		float4 exit = min4(min4(max4(t0x, t1x), max4(t0y, t1y)), max4(t0z, t1z));
+		*t_near = enter;
+		return bits(active & (enter <= exit) & (enter <= t_max));
+	}
+
+	// Smallest entry parameter over the lanes in hits, used to order children
+	inline float nearestLane(float4 t_near, int hits)
+	{
+		float lanes[RayPacket::size];
+		store4(lanes, t_near);
+		float nearest = no_hit;
+		for(int lane = 0; lane < RayPacket::size; ++lane)
+		{
+			if(hits >> lane & 1)
+			{
+				nearest = std::min(nearest, lanes[lane]);
+			}
+		}
+		return nearest;
+	}
+}
+
+RayPacket RayTracer::generatePacket(const CameraModel &camera, int i, int j)
+{
+	RayPacket packet;
+	for(int lane = 0; lane < RayPacket::size; ++lane)
+	{
+		int pixel_i = i + lane / 2, pixel_j = j + lane % 2;
+		if(pixel_i < camera.height && pixel_j < camera.width)
+		{
+			packet.set(lane, camera.ray(pixel_i, pixel_j));
+		}
+	}
+	return packet;
+}
+
+// BVH traversal shared by all lanes. A node is visited while any lane still enters
+// it in front of that lane's nearest hit, so coherent rays pay for one walk instead of four.
+void RayTracer::intersectPacket(const RayPacket &packet, const Scene &scene, const Primitive **hit_primitives, vec3 *hit_points)
+{
+	const int size = RayPacket::size;
+	float t_max[size];
+	int slots[size];
+	for(int lane = 0; lane < size; ++lane)
+	{
+		hit_primitives[lane] = nullptr;
+		t_max[lane] = no_hit;
+		slots[lane] = -1;
+	}
+	clearInstanceHits();
+	const BVH &bvh = scene.bvh;
+	if(packet.active == 0)
+	{
+		return;
+	}
+
+	float4 o[3] = {load4(packet.ox), load4(packet.oy), load4(packet.oz)};
+	float4 inv_dir[3] = {set1(1.0f) / load4(packet.dx), set1(1.0f) / load4(packet.dy), set1(1.0f) / load4(packet.dz)};
+	mask4 active = maskFromBits(packet.active);
+	STATS_TIMER(intersect);
+	STATS_COUNT(primary_rays, packet.count());
+	int stack[2 * BVH::max_depth];
+	int stack_size = 0;
+	if(!bvh.empty())
+	{
+		stack[stack_size++] = 0;
+	}
+	while(stack_size > 0)
+	{
+		const BVH::Node &node = bvh.nodes[stack[--stack_size]];
+		STATS_COUNT(node_visits, 1);
+		float4 t_near;
+		int lanes = intersectBox(node.box, o, inv_dir, load4(t_max), active, &t_near);
+		if(lanes == 0)
+		{
+			continue;
+		}
+		if(node.isLeaf())
+		{
+			STATS_COUNT(primitive_tests, node.count);
+			int triangles = scene.primitives.countTriangles(&bvh.indices[node.first], node.count);
+			scene.triangle_buffer.intersect(packet, node.first, triangles, t_max, slots);
+			// The spheres after the triangles take the scalar path one lane at a time
+			for(int k = node.first + triangles; k < node.first + node.count; ++k)
+			{
+				const Sphere &sphere = scene.primitives.sphere(bvh.indices[k]);
+				for(int lane = 0; lane < size; ++lane)
+				{
+					if(!(lanes >> lane & 1))
+					{
+						continue;
+					}
+					Ray ray = packet.ray(lane);
+					vec3 hit;
+					float dist;
+					if(intersectSphere(ray, scene, sphere, &hit, &dist) && dist < t_max[lane] * glm::length(ray.direction))
+					{
+						t_max[lane] = dist / glm::length(ray.direction);
+						slots[lane] = k;
+						hit_points[lane] = hit;
+					}
+				}
+			}
+		}
+		else
+		{
+			float4 t_left, t_right;
+			int hit_left = intersectBox(bvh.nodes[node.first].box, o, inv_dir, load4(t_max), active, &t_left);
+			int hit_right = intersectBox(bvh.nodes[node.first + 1].box, o, inv_dir, load4(t_max), active, &t_right);
+			if(hit_left && hit_right)
+			{
+				if(nearestLane(t_left, hit_left) < nearestLane(t_right, hit_right))
+				{
+					stack[stack_size++] = node.first + 1;
+					stack[stack_size++] = node.first;
+				}
+				else
+				{
+					stack[stack_size++] = node.first;
+					stack[stack_size++] = node.first + 1;
+				}
+			}
+			else if(hit_left)
+			{
+				stack[stack_size++] = node.first;
+			}
+			else if(hit_right)
+			{
+				stack[stack_size++] = node.first + 1;
+			}
+		}
+	}
+
+	for(int lane = 0; lane < size; ++lane)
+	{
+		if(slots[lane] < 0)
+		{
+			continue;
+		}
+		int index = bvh.indices[slots[lane]];
+		hit_primitives[lane] = scene.primitives[index];
+		if(!scene.primitives.isSphere(index))
+		{
+			hit_points[lane] = packet.ray(lane).o + packet.ray(lane).direction * t_max[lane];
+		}
+	}
+
+	// Instances are entered one lane at a time, each lane moves into the object's frame on its own
+	if(scene.instances.empty())
+	{
+		return;
+	}
+	for(int lane = 0; lane < size; ++lane)
+	{
+		if(!(packet.active >> lane & 1))
+		{
+			continue;
+		}
+		Ray ray = packet.ray(lane);
+		float nearest_dist = t_max[lane] * glm::length(ray.direction);
+		intersectInstances(ray, scene, &nearest_dist, hit_primitives[lane], &hit_points[lane]);
+	}
+}
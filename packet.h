@@ -0,0 +1,50 @@
+// Ray packet header file that declares the packet of coherent primary rays
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef PACKET_H
+#define PACKET_H
+
+#include "simd.h"
+#include "primitives.h"
+
+// A 2x2 block of rays stored component wise, so that each component of all lanes
+// loads into one float4. Lanes whose bit is clear in active carry no ray, which
+// happens on the right and bottom borders of images with odd sizes.
+struct RayPacket
+{
+	static const int size = 4;
+
+	float ox[size], oy[size], oz[size];
+	float dx[size], dy[size], dz[size];
+	int active;
+
+	RayPacket() : active(0)
+	{
+		for(int lane = 0; lane < size; ++lane)
+		{
+			ox[lane] = oy[lane] = oz[lane] = 0.0f;
+			dx[lane] = dy[lane] = dz[lane] = 0.0f;
+		}
+	}
+
+	void set(int lane, const Ray &ray)
+	{
+		ox[lane] = ray.o.x; oy[lane] = ray.o.y; oz[lane] = ray.o.z;
+		dx[lane] = ray.direction.x; dy[lane] = ray.direction.y; dz[lane] = ray.direction.z;
+		active |= 1 << lane;
+	}
+
+	int count() const
+	{
+		int lanes = 0;
+		for(int lane = 0; lane < size; ++lane)
+		{
+			lanes += active >> lane & 1;
+		}
+		return lanes;
+	}
+
+	Ray ray(int lane) const { return Ray(vec3(ox[lane], oy[lane], oz[lane]), vec3(dx[lane], dy[lane], dz[lane])); }
+};
+
+#endif
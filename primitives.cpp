@@ -4,6 +4,9 @@
 
 #include "primitives.h"
 #include <iostream>
+#include <cmath>
+#include <functional>
+#include <cstring>
 
 const float eps = 1e-6;
 
@@ -13,6 +16,75 @@ bool isSameVector(const vec3& a, const vec3& b) {
     return glm::dot(b-a, b-a) < eps;
 }
 
+vec3 transformPoint(const vec3& point, const mat4& transform)
+{
+    vec4 p_hom = vec4(point, 1.0f) * transform;
+    return vec3(p_hom.x / p_hom.w, p_hom.y / p_hom.w, p_hom.z / p_hom.w);
+}
+
+AABB::AABB() : lo(INFINITY, INFINITY, INFINITY), hi(-INFINITY, -INFINITY, -INFINITY) {}
+
+void AABB::expand(const vec3& point)
+{
+    lo = glm::min(lo, point);
+    hi = glm::max(hi, point);
+}
+
+void AABB::expand(const AABB& box)
+{
+    lo = glm::min(lo, box.lo);
+    hi = glm::max(hi, box.hi);
+}
+
+vec3 AABB::centroid() const
+{
+    return (lo + hi) * 0.5f;
+}
+
+float AABB::surfaceArea() const
+{
+    vec3 d = hi - lo;
+    if(d.x < 0 || d.y < 0 || d.z < 0)
+    {
+        return 0.0f;
+    }
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+size_t Mat4BitsHash::operator () (const mat4& m) const
+{
+    unsigned int bits[16];
+    memcpy(bits, &m[0][0], sizeof(bits));
+    size_t seed = 0;
+    for(int k = 0; k < 16; ++k)
+    {
+        seed ^= std::hash<unsigned int>()(bits[k]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+}
+
+bool Mat4BitsEqual::operator () (const mat4& a, const mat4& b) const
+{
+    return memcmp(&a[0][0], &b[0][0], sizeof(mat4)) == 0;
+}
+
+// Slab test. t_near is the parametric entry distance along the ray, clamped to 0
+bool AABB::intersect(const Ray& ray, const vec3& inv_dir, float* t_near) const
+{
+    vec3 t0 = (lo - ray.o) * inv_dir;
+    vec3 t1 = (hi - ray.o) * inv_dir;
+    vec3 t_min = glm::min(t0, t1);
+    vec3 t_max = glm::max(t0, t1);
+    float enter = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+    float exit = std::min(std::min(t_max.x, t_max.y), t_max.z);
+    if(enter > exit)
+    {
+        return false;
+    }
+    *t_near = enter;
+    return true;
+}
+
 bool Color::operator == (const Color& otherColor) const
 {
     return r == otherColor.r && g == otherColor.g && b == otherColor.b;
@@ -37,17 +109,52 @@ bool Color::isZero() const { return Rbyte() == 0 && Gbyte() == 0 && Bbyte() == 0
 
 Materials::Materials() : shininess(0.0) {}
 
-Sphere::Sphere(const vec3& o_, const float& r_): o(o_), r(r_)
+bool Materials::operator == (const Materials& otherMaterials) const
+{
+    return diffuse == otherMaterials.diffuse && specular == otherMaterials.specular && emission == otherMaterials.emission && ambient == otherMaterials.ambient && shininess == otherMaterials.shininess;
+}
+
+size_t MaterialsHash::operator () (const Materials& materials) const
+{
+    const float values[13] = {materials.diffuse.r, materials.diffuse.g, materials.diffuse.b, materials.specular.r, materials.specular.g, materials.specular.b, materials.emission.r, materials.emission.g, materials.emission.b, materials.ambient.r, materials.ambient.g, materials.ambient.b, materials.shininess};
+    size_t seed = 0;
+    for(int k = 0; k < 13; ++k)
+    {
+        seed ^= std::hash<float>()(values[k]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+}
+
+vec3 Primitive::interpolatePointNormal(const vec3& point, const mat4& inversedtransform) const
+{
+    switch(type)
+    {
+    case sphere:
+        return static_cast<const Sphere*>(this)->interpolatePointNormal(point, inversedtransform);
+    default:
+        return static_cast<const Triangle*>(this)->interpolatePointNormal(point, inversedtransform);
+    }
+}
+
+AABB Primitive::bounds(const mat4& transform) const
 {
-    type = sphere;
+    switch(type)
+    {
+    case sphere:
+        return static_cast<const Sphere*>(this)->bounds(transform);
+    default:
+        return static_cast<const Triangle*>(this)->bounds(transform);
+    }
 }
 
+Sphere::Sphere(const vec3& o_, const float& r_): Primitive(sphere), o(o_), r(r_) {}
+
 bool Sphere::intersect(const Ray& ray, float* dis_to_ray) const
 {
     const vec3& dir = ray.direction;
     const vec3& p = ray.o;
     float c2 = glm::dot(dir, dir);
-    float c1 = 2 * glm::dot(dir, p - o)
+    float c1 = 2 * glm::dot(dir, p - o);
     float c0 = glm::dot(p - o, p - o) - r * r;
     float delta = c1 * c1 - 4 * c2 * c0;
     if(delta < -eps)
@@ -67,33 +174,44 @@ bool Sphere::intersect(const Ray& ray, float* dis_to_ray) const
     }
 }
 
-vec3 Sphere::interpolatePointNormal(const vec3& point) const
+vec3 Sphere::interpolatePointNormal(const vec3& point, const mat4& inversedtransform) const
 {
-    vec4 p_hom = vec4(point, 1.0f) * this->inversed_transform;
+    vec4 p_hom = vec4(point, 1.0f) * inversedtransform;
     vec3 p_dehom = vec3(p_hom.x / p_hom.w, p_hom.y / p_hom.w, p_hom.z / p_hom.w);
-    return vec3(vec4(p_dehom - o, 0.0f) * glm::transpose(this->inversed_transform));
+    return vec3(vec4(p_dehom - o, 0.0f) * glm::transpose(inversedtransform));
 }
 
-Triangle::Triangle(const vec3& a_, const vec3& b_, const vec3& c_, vec3 na_, vec3 nb_, vec3 nc_) : a(vertices[0]), b(vertices[1]), c(vertices[2]), na(vertexNormals[0]), nb(vertexNormals[1]), nc(vertexNormals[2])
+AABB Sphere::bounds(const mat4& transform) const
 {
-    a = a_;
-    b = b_;
-    c = c_;
-    type = triangle;
+    AABB box;
+    for(int corner = 0; corner < 8; ++corner)
+    {
+        vec3 p(corner & 1 ? o.x + r : o.x - r, corner & 2 ? o.y + r : o.y - r, corner & 4 ? o.z + r : o.z - r);
+        box.expand(transformPoint(p, transform));
+    }
+    return box;
+}
+
+Triangle::Triangle(const vec3& a_, const vec3& b_, const vec3& c_, vec3 na_, vec3 nb_, vec3 nc_) : Primitive(triangle)
+{
+    vertexes[0] = a_;
+    vertexes[1] = b_;
+    vertexes[2] = c_;
     if(na_ == vec3(0, 0, 0))
     {
-        na = nb = nc = glm::cross(b-a, c-a);
+        vertexNormals[0] = vertexNormals[1] = vertexNormals[2] = glm::cross(b_-a_, c_-a_);
     }
     else
     {
-        na = na_;
-        nb = nb_;
-        nc = nc_;
+        vertexNormals[0] = na_;
+        vertexNormals[1] = nb_;
+        vertexNormals[2] = nc_;
     }
 }
 
-Triangle::intersect(const Ray& ray, float *dist_to_ray) const
+bool Triangle::intersect(const Ray& ray, float *dist_to_ray) const
 {
+    const vec3 &a = vertexes[0], &b = vertexes[1], &c = vertexes[2];
     vec3 n = glm::cross(b-a, c-a);
     const vec3& p = ray.o;
     const vec3& dir = ray.direction;
@@ -115,13 +233,15 @@ Triangle::intersect(const Ray& ray, float *dist_to_ray) const
     vec3 tmp_nb = glm::cross(c - p0, a - p0);
     vec3 tmp_nc = glm::cross(a - p0, b - p0);
 
-    float beta = glm::dot(n, tmp_nb) / glm::dot(n, n);
-    float gamma = glm::dot(n, tmp_nc) / glm::dot(n, n);
+    float inv_n2 = 1.0f / glm::dot(n, n);
+    float beta = glm::dot(n, tmp_nb) * inv_n2;
+    float gamma = glm::dot(n, tmp_nc) * inv_n2;
     float alpha = 1 - beta - gamma;
 
     if((alpha > -eps) && (alpha < 1 + eps) && (beta > -eps) && (beta < 1 + eps) && (gamma > -eps) && (gamma < 1 + eps))
     {
         *dist_to_ray = t;
+        return true;
     }
     else
     {
@@ -129,10 +249,16 @@ Triangle::intersect(const Ray& ray, float *dist_to_ray) const
     }
 }
 
-Triangle::interpolatePointNormal(const vec3& point) const
+vec3 Triangle::interpolatePointNormal(const vec3& point, const mat4& inversedtransform) const
 {
-    vec4 p_hom = vec4(point, 1.0f) * this->inversed_transform;
-    vec3 p_dehom = vec3(p_hom.x / p_hom.w, p_hom.y / p_hom.w, p_hom.z / p_hom.w);
+    const vec3 &a = vertexes[0], &b = vertexes[1], &c = vertexes[2];
+    const vec3 &na = vertexNormals[0], &nb = vertexNormals[1], &nc = vertexNormals[2];
+    vec3 p_dehom = point;
+    if(!world_space)
+    {
+        vec4 p_hom = vec4(point, 1.0f) * inversedtransform;
+        p_dehom = vec3(p_hom.x / p_hom.w, p_hom.y / p_hom.w, p_hom.z / p_hom.w);
+    }
     vec3 n = glm::cross(b-a, c-a);
     vec3 tmp_nb = glm::cross(c - p_dehom, a - p_dehom);
     vec3 tmp_nc = glm::cross(a - p_dehom, b - p_dehom);
@@ -142,11 +268,37 @@ Triangle::interpolatePointNormal(const vec3& point) const
     float alpha = 1 - beta - gamma;
 
     vec3 ret = (na * alpha) + (nb * beta) + (nc * gamma);
-    return vec3(vec4(ret, 0.0f) * glm::transpose(this->inversed_transform));
+    if(world_space)
+    {
+        return ret;
+    }
+    return vec3(vec4(ret, 0.0f) * glm::transpose(inversedtransform));
 }
 
-Object::~Object() {}
-
-Triangle::~Triangle() {}
+AABB Triangle::bounds(const mat4& transform) const
+{
+    AABB box;
+    for(int k = 0; k < 3; ++k)
+    {
+        box.expand(world_space ? vertexes[k] : transformPoint(vertexes[k], transform));
+    }
+    return box;
+}
 
-Sphere::~Sphere() {}
\ No newline at end of file
+// Moves the vertices and normals into world space once at load time, so rays
+// hit the triangle directly and never go through the inverse transform.
+void Triangle::toWorldSpace(const mat4& transform, const mat4& inversedtransform)
+{
+    if(world_space)
+    {
+        return;
+    }
+    mat4 normal_transform = glm::transpose(inversedtransform);
+    for(int k = 0; k < 3; ++k)
+    {
+        vertexes[k] = transformPoint(vertexes[k], transform);
+        vertexNormals[k] = vec3(vec4(vertexNormals[k], 0.0f) * normal_transform);
+    }
+    transform_id = 0; // Identity entry of the scene's transform table
+    world_space = true;
+}
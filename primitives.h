@@ -5,9 +5,10 @@
 #ifndef PRIMITIVES_H
 #define PRIMITIVES_H
 
-#include <glm/glm.h>
+#include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <algorithm>
+#include <vector>
 
 typedef glm::mat3 mat3;
 typedef glm::mat4 mat4;
@@ -18,6 +19,7 @@ typedef unsigned char BYTE;
 extern const float eps;
 int sgn(float x);
 bool isSameVector(const vec3& a, const vec3& b);
+vec3 transformPoint(const vec3& point, const mat4& transform);
 
 struct Ray
 {
@@ -26,6 +28,18 @@ struct Ray
 	Ray(const vec3& o_, const vec3& direction_) : o(o_), direction(direction_) {}
 };
 
+// Axis aligned bounding box in world space, used by the acceleration structure
+struct AABB
+{
+	vec3 lo, hi;
+	AABB();
+	void expand(const vec3& point);
+	void expand(const AABB& box);
+	vec3 centroid() const;
+	float surfaceArea() const;
+	bool intersect(const Ray& ray, const vec3& inv_dir, float* t_near) const;
+};
+
 struct Color
 {
 	float r, g, b;
@@ -39,6 +53,7 @@ struct Color
 	Color operator + (const Color& otherColor) const;
 	Color operator * (const float scale) const;
 	bool isZero() const;
+	float maxComponent() const { return std::max(r, std::max(g, b)); }
 };
 
 const Color BLACK(0, 0, 0);
@@ -52,52 +67,106 @@ struct Materials
 	Color ambient;
 	float shininess;
 	Materials();
+	bool operator == (const Materials& otherMaterials) const;
+};
+
+struct MaterialsHash
+{
+	size_t operator () (const Materials& materials) const;
+};
+
+// Hash and equality on the raw bits of a matrix, for interning transforms
+struct Mat4BitsHash
+{
+	size_t operator () (const mat4& m) const;
+};
+
+struct Mat4BitsEqual
+{
+	bool operator () (const mat4& a, const mat4& b) const;
 };
 
+// Primitives live by value in the scene's arena, grouped by shape. Intersection runs
+// over each shape's array on its own; shading and BVH builds dispatch on the type tag
+// instead of a vtable. Materials and transforms are shared through tables in the
+// scene and referenced by index, so the common part is 12 bytes.
 class Primitive
 {
 public:
-	mat4 transform; 
-  	mat4 inversedtransform;
-  	Materials materials;	
-    
-    int index; // Identify the object for debugging.
-    
-    enum shape {triangle, sphere} ;
+    int material_id;
+    int transform_id;
+
+    enum shape : unsigned char {triangle, sphere} ;
     shape type; 
+    bool world_space; // Transform already baked into the geometry, intersect without transforming the ray
     
-	Object();
-	virtual ~Object();
-	virtual bool intersect(const Ray& ray, float* dis_to_ray) const = 0;
-	virtual vec3 interpolatePointNormal(const vec3& point) const = 0;
+	vec3 interpolatePointNormal(const vec3& point, const mat4& inversedtransform) const;
+	AABB bounds(const mat4& transform) const;
 
+protected:
+	Primitive(shape type_) : material_id(0), transform_id(0), type(type_), world_space(false) {}
 };
 
 
 class Sphere : public Primitive 
 {
 public:
-	Svec3 o;
+	vec3 o;
 	float r;
 	Sphere(const vec3& o_, const float& r_);
 	
-	virtual ~Sphere();
-	virtual bool intersect(const Ray& ray, float* dis_to_ray) const;
-	virtual vec3 interpolatePointNormal(const vec3& point) const;
-}
+	bool intersect(const Ray& ray, float* dis_to_ray) const;
+	vec3 interpolatePointNormal(const vec3& point, const mat4& inversedtransform) const;
+	AABB bounds(const mat4& transform) const;
+};
 
 class Triangle : public Primitive
 {
 public:
 	vec3 vertexes[3], vertexNormals[3];
-    vec3 &a, &b, &c;
-    vec3 &na, &nb, &nc;
     
 	Triangle(const vec3& a_, const vec3& b_, const vec3& c_, vec3 na = vec3(0,0,0), vec3 nb = vec3(0,0,0), vec3 nc = vec3(0,0,0));
     
-    virtual ~Triangle();
-    virtual bool intersect(const Ray& ray, float* dis_to_ray) const;
-    virtual vec3 interpolatePointNormal(const vec3& point) const;
-}
+    bool intersect(const Ray& ray, float* dis_to_ray) const;
+    vec3 interpolatePointNormal(const vec3& point, const mat4& inversedtransform) const;
+    AABB bounds(const mat4& transform) const;
+
+    void toWorldSpace(const mat4& transform, const mat4& inversedtransform);
+};
+
+// The geometry of one BVH numbered the way its references are: triangles first, then
+// spheres. Points into the typed arrays, which must not grow while it is in use.
+struct PrimitiveView
+{
+	const Triangle *triangles;
+	const Sphere *spheres;
+	int num_triangles, num_spheres;
+
+	PrimitiveView() : triangles(NULL), spheres(NULL), num_triangles(0), num_spheres(0) {}
+	PrimitiveView(const std::vector<Triangle>& triangles_, const std::vector<Sphere>& spheres_)
+		: triangles(triangles_.data()), spheres(spheres_.data()), num_triangles(triangles_.size()), num_spheres(spheres_.size()) {}
+
+	size_t size() const { return num_triangles + num_spheres; }
+	bool isSphere(int index) const { return index >= num_triangles; }
+	const Sphere &sphere(int index) const { return spheres[index - num_triangles]; }
+	const Primitive *operator [] (int index) const
+	{
+		return isSphere(index) ? static_cast<const Primitive*>(&sphere(index)) : &triangles[index];
+	}
+	// BVH leaves list their references in ascending order, so the triangles among count
+	// references come first. Returns how many there are.
+	int countTriangles(const int *references, int count) const
+	{
+		while(count > 0 && isSphere(references[count - 1]))
+		{
+			--count;
+		}
+		return count;
+	}
+	int indexOf(const Primitive *primitive) const
+	{
+		return primitive->type == Primitive::sphere ? num_triangles + (static_cast<const Sphere*>(primitive) - spheres) : static_cast<const Triangle*>(primitive) - triangles;
+	}
+};
 
 #endif
\ No newline at end of file
@@ -2,105 +2,567 @@
 // Author: Sasidharan Mahalingam
 // Date Created: 2 Dec 2023
 
-Ray RayTracer::generateRay(const Camera& camera, int i, int j, int height, int width)
-{
-	vec3 w = glm::normalize(camera.eye - camera.center);
-	vec3 u = glm::normalize(glm::cross(camera.up, w));
-	vec3 v = glm::cross(w, u);
+#include <cmath>
+#include <algorithm>
+#include "Transform.h"
+#include "raytracer.h"
 
-	float fovy = camera.fovy * PI / 180.0;
-	float fovx = 2 * atan(tan(fovy / 2.0) * width / height);
-	float a = tan(fovx/2.0) * (j - (width / 2.0)) / (width / 2.0);
-	float b = tan(fovy/2.0) * ((height / 2.0) - i) / (height / 2.0);
-	return Ray(camera.eye, -w + u * a + v * b);
+Ray RayTracer::generateRay(const CameraModel& camera, int i, int j)
+{
+	return camera.ray(i, j);
 }
 
-Ray RayTracer::transformRay(const Ray &ray, const primitive * primitive)
+Ray RayTracer::transformRay(const Ray &ray, const mat4 &inversedtransform)
 {
 	vec4 o_extend(ray.o, 1);
-	vac4 dir_extend(ray.direction, 0.0);
-	o_extend = o_extend * primitive->inversedtransform;
-	dir_extend = dir_extend * primitive->inversedtransform;
-	vec3 o = vec3(o_extend.x / o_extend.w, o_extend.y / o_extend.w, o_extend.z / o.o_extend.w);
+	vec4 dir_extend(ray.direction, 0.0);
+	o_extend = o_extend * inversedtransform;
+	dir_extend = dir_extend * inversedtransform;
+	vec3 o = vec3(o_extend.x / o_extend.w, o_extend.y / o_extend.w, o_extend.z / o_extend.w);
 	vec3 dir = vec3(dir_extend.x, dir_extend.y, dir_extend.z);
 	return Ray(o, dir);
 }
 
-bool RayTracer::getIntersection(const Ray &ray, const Scene &scene, const primitive *&hit_object, vec3* hit_point)
+// Spheres are never baked, the ray moves into the sphere's frame instead
+bool RayTracer::intersectSphere(const Ray &ray, const Scene &scene, const Sphere &sphere, vec3 *hit_point, float *dist)
+{
+	float t;
+	Ray transformed_ray = transformRay(ray, scene.inversedTransform(&sphere));
+	if(!sphere.intersect(transformed_ray, &t))
+	{
+		return false;
+	}
+	vec3 hit_transformed = transformed_ray.o + transformed_ray.direction * t;
+	vec4 hit_transformed_hom(hit_transformed, 1.0);
+	hit_transformed_hom = hit_transformed_hom * scene.transform(&sphere);
+	*hit_point = vec3(hit_transformed_hom.x / hit_transformed_hom.w, hit_transformed_hom.y / hit_transformed_hom.w, hit_transformed_hom.z / hit_transformed_hom.w);
+	*dist = glm::length(*hit_point - ray.o);
+	return true;
+}
+
+bool RayTracer::getIntersection(const Ray &ray, const Scene &scene, const Primitive *&hit_primitive, vec3* hit_point)
 {
+	STATS_TIMER(intersect);
 	float nearest_dist = INF;
 	hit_primitive = nullptr;
-	for(unsigned int i = 0; i < scene.primitives.size(); ++i)
+	if(scene.traversal == Scene::wide)
+	{
+		intersectWide(ray, scene, &nearest_dist, hit_primitive, hit_point);
+	}
+	else
+	{
+		intersectBVH(ray, scene, scene.bvh, scene.triangle_buffer, scene.primitives, &nearest_dist, hit_primitive, hit_point);
+	}
+	if(!scene.instances.empty())
+	{
+		intersectInstances(ray, scene, &nearest_dist, hit_primitive, hit_point);
+	}
+	return hit_primitive != nullptr;
+}
+
+bool RayTracer::intersectBVH(const Ray &ray, const Scene &scene, const BVH &bvh, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point)
+{
+	if(bvh.empty())
+	{
+		return false;
+	}
+
+	// Node boxes are tested in ray parameter space, hits are compared in distance along the ray
+	vec3 inv_dir = 1.0f / ray.direction;
+	float dir_length = glm::length(ray.direction);
+	bool found = false;
+	// A node and the ray parameter it is entered at. Children are pushed with the entry
+	// their box test gave, and one whose entry lies beyond a hit found since is dropped
+	// when popped without testing its box again.
+	struct Entry
+	{
+		int node;
+		float t;
+	};
+	Entry stack[2 * BVH::max_depth];
+	int stack_size = 0;
+	float t_root;
+	if(!bvh.nodes[0].box.intersect(ray, inv_dir, &t_root))
+	{
+		return false;
+	}
+	Entry root = {0, t_root};
+	stack[stack_size++] = root;
+	while(stack_size > 0)
+	{
+		const Entry entry = stack[--stack_size];
+		if(entry.t * dir_length > *nearest_dist)
+		{
+			continue;
+		}
+		const BVH::Node &node = bvh.nodes[entry.node];
+		STATS_COUNT(node_visits, 1);
+		if(node.isLeaf())
+		{
+			found |= intersectLeaf(ray, scene, triangle_buffer, primitives, bvh.indices, node.first, node.count, nearest_dist, hit_primitive, hit_point);
+		}
+		else
+		{
+			// Visit the child on the near side of the ray first
+			float t_left, t_right;
+			bool hit_left = bvh.nodes[node.first].box.intersect(ray, inv_dir, &t_left);
+			bool hit_right = bvh.nodes[node.first + 1].box.intersect(ray, inv_dir, &t_right);
+			Entry left = {node.first, t_left};
+			Entry right = {node.first + 1, t_right};
+			if(hit_left && hit_right)
+			{
+				if(t_left < t_right)
+				{
+					stack[stack_size++] = right;
+					stack[stack_size++] = left;
+				}
+				else
+				{
+					stack[stack_size++] = left;
+					stack[stack_size++] = right;
+				}
+			}
+			else if(hit_left)
+			{
+				stack[stack_size++] = left;
+			}
+			else if(hit_right)
+			{
+				stack[stack_size++] = right;
+			}
+		}
+	}
+	return found;
+}
+
+// Primitives in slots [first, first + count) of a leaf. The leaf's triangles go through
+// the SIMD kernel and the spheres that follow them through a loop of their own.
+bool RayTracer::intersectLeaf(const Ray &ray, const Scene &scene, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives, const vector<int> &indices, int first, int count, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point)
+{
+	STATS_COUNT(primitive_tests, count);
+	bool found = false;
+	float dir_length = glm::length(ray.direction);
+	float t_max = *nearest_dist / dir_length;
+	int slot;
+	int triangles = primitives.countTriangles(&indices[first], count);
+	if(triangles > 0 && triangle_buffer.intersect(ray, first, triangles, &t_max, &slot))
+	{
+		*nearest_dist = t_max * dir_length;
+		hit_primitive = &primitives.triangles[indices[slot]];
+		*hit_point = ray.o + ray.direction * t_max;
+		found = true;
+	}
+	for(int k = first + triangles; k < first + count; ++k)
 	{
-		Ray transformed_ray = transformRay(ray, scene.primitives[i]);
+		const Sphere &sphere = primitives.sphere(indices[k]);
+		vec3 hit;
 		float dist;
-		if(scene.primitives[i]->intersect(transformed_ray, &dist))
-		{
-			vec3 hit_transformed = transformed_ray.o + transformed_ray.direction * dist;
-			vec4 hit_transformed_hom(hit_transformed, 1.0);
-			hit_transformed_hom = hit_transformed_hom * scene.primitives[i]->transform;
-			vec3 hit = vec3(hit_transformed_hom.x / hit_transformed_hom.w, hit_transformed_hom.y / hit_transformed_hom.w, hit_transformed_hom.z / hit_transformed_hom.w);
-			dist = glm::length(hit - ray.o);
-			if(dist < nearest_dist)
+		if(intersectSphere(ray, scene, sphere, &hit, &dist) && dist < *nearest_dist)
+		{
+			*nearest_dist = dist;
+			hit_primitive = &sphere;
+			*hit_point = hit;
+			found = true;
+		}
+	}
+	return found;
+}
+
+// Same walk as intersectBVH over the 8 wide nodes. All children of a node are tested
+// at once and the ones hit are pushed far to near, so the nearest is visited first.
+bool RayTracer::intersectWide(const Ray &ray, const Scene &scene, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point)
+{
+	const BVH8 &bvh8 = scene.bvh8;
+	if(bvh8.empty())
+	{
+		return false;
+	}
+
+	BVH8::TraversalRay traversal_ray(ray);
+	float dir_length = glm::length(ray.direction);
+	bool found = false;
+	// A child is its node or first slot, its leaf count and the parameter it is entered at
+	struct Entry
+	{
+		int child;
+		int count;
+		float t;
+	};
+	Entry stack[BVH8::width * BVH::max_depth];
+	int stack_size = 0;
+	Entry root = {0, 0, 0.0f};
+	stack[stack_size++] = root;
+	while(stack_size > 0)
+	{
+		const Entry entry = stack[--stack_size];
+		if(entry.t * dir_length > *nearest_dist)
+		{
+			continue;
+		}
+		if(entry.count > 0)
+		{
+			found |= intersectLeaf(ray, scene, scene.triangle_buffer, scene.primitives, scene.bvh.indices, entry.child, entry.count, nearest_dist, hit_primitive, hit_point);
+			continue;
+		}
+
+		const BVH8::Node &node = bvh8.nodes[entry.child];
+		STATS_COUNT(node_visits, 1);
+		float t_near[BVH8::width];
+		int hits = BVH8::intersectChildren(node, traversal_ray, *nearest_dist / dir_length, t_near);
+		int order[BVH8::width];
+		int num_hits = 0;
+		for(; hits != 0; hits &= hits - 1)
+		{
+			// Insertion sort on entry parameter, farthest first
+			int k = __builtin_ctz(hits);
+			int position = num_hits++;
+			for(; position > 0 && t_near[order[position - 1]] < t_near[k]; --position)
 			{
-				nearest_dist = dist;
-				hit_primitive = scene.primitives[i];
-				*hit_point = hit;
-			} 
+				order[position] = order[position - 1];
+			}
+			order[position] = k;
+		}
+		for(int h = 0; h < num_hits; ++h)
+		{
+			int k = order[h];
+			Entry child = {node.child[k], node.count[k], t_near[k]};
+			stack[stack_size++] = child;
 		}
 	}
-	if(hit_primitive == nullptr)
+	return found;
+}
+
+// Walks the top level BVH and enters an object only at an instance leaf: the ray is moved
+// into the object's frame once and the object's BVH is walked there. The ray parameter is
+// the same in both frames, distances are rescaled by the length of the moved direction.
+bool RayTracer::intersectInstances(const Ray &ray, const Scene &scene, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point)
+{
+	const BVH &bvh = scene.instance_bvh;
+	vec3 inv_dir = 1.0f / ray.direction;
+	float dir_length = glm::length(ray.direction);
+	const Primitive *nearest = nullptr;
+	int nearest_transform = 0;
+	float nearest_t = 0.0f;
+	int stack[2 * BVH::max_depth];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while(stack_size > 0)
+	{
+		const BVH::Node &node = bvh.nodes[stack[--stack_size]];
+		STATS_COUNT(node_visits, 1);
+		float t_near;
+		if(!node.box.intersect(ray, inv_dir, &t_near) || t_near * dir_length > *nearest_dist)
+		{
+			continue;
+		}
+		if(!node.isLeaf())
+		{
+			stack[stack_size++] = node.first;
+			stack[stack_size++] = node.first + 1;
+			continue;
+		}
+		for(int k = node.first; k < node.first + node.count; ++k)
+		{
+			const Instance &instance = scene.instances[bvh.indices[k]];
+			const Object &object = scene.objects[instance.object];
+			Ray local = transformRay(ray, scene.inversed_transforms[instance.transform_id]);
+			float scale = glm::length(local.direction) / dir_length;
+			float local_dist = *nearest_dist * scale;
+			const Primitive *primitive = nullptr;
+			vec3 local_hit;
+			if(intersectBVH(local, scene, object.bvh, object.triangle_buffer, object.primitives, &local_dist, primitive, &local_hit))
+			{
+				*nearest_dist = local_dist / scale;
+				nearest = primitive;
+				nearest_transform = scene.instance_transforms[instance.first_transform + object.transform_slots[object.primitives.indexOf(primitive)]];
+				nearest_t = *nearest_dist / dir_length;
+			}
+		}
+	}
+	if(nearest == nullptr)
 	{
 		return false;
 	}
+	hit_primitive = instanceHit(nearest, nearest_transform);
+	*hit_point = ray.o + ray.direction * nearest_t;
+	return true;
+}
+
+// The primitive of an object is shared by every instance, so the hit is a copy of it
+// that carries the instance's composed transform and is shaded like any transformed primitive
+const Primitive *RayTracer::instanceHit(const Primitive *primitive, int transform_id)
+{
+	Primitive *copy;
+	if(primitive->type == Primitive::sphere)
+	{
+		instance_spheres.push_back(*static_cast<const Sphere*>(primitive));
+		copy = &instance_spheres.back();
+	}
 	else
+	{
+		instance_triangles.push_back(*static_cast<const Triangle*>(primitive));
+		copy = &instance_triangles.back();
+	}
+	copy->transform_id = transform_id;
+	copy->world_space = false;
+	return copy;
+}
+
+void RayTracer::clearInstanceHits()
+{
+	instance_triangles.clear();
+	instance_spheres.clear();
+}
+
+bool RayTracer::occluded(const vec3 &origin, const vec3 &target, const Scene &scene)
+{
+	vec3 to_target = target - origin;
+	float dist = glm::length(to_target);
+	return occluded(Ray(origin, to_target / dist), dist, scene);
+}
+
+// Any hit traversal for shadow rays, stops at the first blocker closer than max_dist.
+// Hits right at the origin are rejected by the primitives' own minimum distance.
+bool RayTracer::occluded(const Ray &ray, float max_dist, const Scene &scene)
+{
+	STATS_TIMER(shadow);
+	STATS_COUNT(shadow_rays, 1);
+	bool blocked = scene.traversal == Scene::wide ? occludedWide(ray, max_dist, scene) : occludedBVH(ray, max_dist, scene, scene.bvh, scene.triangle_buffer, scene.primitives);
+	return blocked || (!scene.instances.empty() && occludedInstances(ray, max_dist, scene));
+}
+
+bool RayTracer::occludedBVH(const Ray &ray, float max_dist, const Scene &scene, const BVH &bvh, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives)
+{
+	if(bvh.empty())
+	{
+		return false;
+	}
+
+	vec3 inv_dir = 1.0f / ray.direction;
+	float dir_length = glm::length(ray.direction);
+	int stack[2 * BVH::max_depth];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while(stack_size > 0)
+	{
+		const BVH::Node &node = bvh.nodes[stack[--stack_size]];
+		STATS_COUNT(node_visits, 1);
+		float t_near;
+		if(!node.box.intersect(ray, inv_dir, &t_near) || t_near * dir_length > max_dist)
+		{
+			continue;
+		}
+		if(node.isLeaf())
+		{
+			if(occludedLeaf(ray, max_dist, scene, triangle_buffer, primitives, bvh.indices, node.first, node.count))
+			{
+				return true;
+			}
+		}
+		else
+		{
+			stack[stack_size++] = node.first;
+			stack[stack_size++] = node.first + 1;
+		}
+	}
+	return false;
+}
+
+bool RayTracer::occludedLeaf(const Ray &ray, float max_dist, const Scene &scene, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives, const vector<int> &indices, int first, int count)
+{
+	STATS_COUNT(primitive_tests, count);
+	int triangles = primitives.countTriangles(&indices[first], count);
+	if(triangles > 0 && triangle_buffer.occluded(ray, first, triangles, max_dist / glm::length(ray.direction)))
 	{
 		return true;
 	}
+	for(int k = first + triangles; k < first + count; ++k)
+	{
+		vec3 hit;
+		float dist;
+		if(intersectSphere(ray, scene, primitives.sphere(indices[k]), &hit, &dist) && dist < max_dist)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Any hit walk over the 8 wide nodes, children are visited in slot order
+bool RayTracer::occludedWide(const Ray &ray, float max_dist, const Scene &scene)
+{
+	const BVH8 &bvh8 = scene.bvh8;
+	if(bvh8.empty())
+	{
+		return false;
+	}
+
+	BVH8::TraversalRay traversal_ray(ray);
+	float t_max = max_dist / glm::length(ray.direction);
+	int stack[BVH8::width * BVH::max_depth];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while(stack_size > 0)
+	{
+		const BVH8::Node &node = bvh8.nodes[stack[--stack_size]];
+		STATS_COUNT(node_visits, 1);
+		float t_near[BVH8::width];
+		for(int hits = BVH8::intersectChildren(node, traversal_ray, t_max, t_near); hits != 0; hits &= hits - 1)
+		{
+			int k = __builtin_ctz(hits);
+			if(node.count[k] == 0)
+			{
+				stack[stack_size++] = node.child[k];
+			}
+			else if(occludedLeaf(ray, max_dist, scene, scene.triangle_buffer, scene.primitives, scene.bvh.indices, node.child[k], node.count[k]))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
-bool RayTracer::Trace(const Ray& ray, const Scene& scene, int depth, int pixH, int pixW)
+bool RayTracer::occludedInstances(const Ray &ray, float max_dist, const Scene &scene)
+{
+	const BVH &bvh = scene.instance_bvh;
+	vec3 inv_dir = 1.0f / ray.direction;
+	float dir_length = glm::length(ray.direction);
+	int stack[2 * BVH::max_depth];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while(stack_size > 0)
+	{
+		const BVH::Node &node = bvh.nodes[stack[--stack_size]];
+		STATS_COUNT(node_visits, 1);
+		float t_near;
+		if(!node.box.intersect(ray, inv_dir, &t_near) || t_near * dir_length > max_dist)
+		{
+			continue;
+		}
+		if(!node.isLeaf())
+		{
+			stack[stack_size++] = node.first;
+			stack[stack_size++] = node.first + 1;
+			continue;
+		}
+		for(int k = node.first; k < node.first + node.count; ++k)
+		{
+			const Instance &instance = scene.instances[bvh.indices[k]];
+			const Object &object = scene.objects[instance.object];
+			Ray local = transformRay(ray, scene.inversed_transforms[instance.transform_id]);
+			float scale = glm::length(local.direction) / dir_length;
+			if(occludedBVH(local, max_dist * scale, scene, object.bvh, object.triangle_buffer, object.primitives))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+Color RayTracer::trace(const Ray& ray, const Scene& scene, int depth)
 {
 	if(depth > scene.max_depth)
 	{
 		return BLACK;
 	}
-	const primitive* hit_primitive;
+	if(depth == 0)
+	{
+		STATS_COUNT(primary_rays, 1);
+		clearInstanceHits();
+	}
+	const Primitive* hit_primitive;
 	vec3 hit_point;
 	if(!getIntersection(ray, scene, hit_primitive, &hit_point))
 	{
 		return BLACK;
 	}
-	Color color(hit_primitive->materials.ambient + hit_primitive->materials.emission);
+	return shade(ray, scene, hit_primitive, hit_point, depth);
+}
+
+// Reflections are followed in a loop rather than by recursion. Each bounce scales the
+// path throughput by the specular color of the surface it leaves, and the walk ends
+// at max_depth or once the throughput falls below the scene's min_throughput.
+Color RayTracer::shade(const Ray& ray, const Scene& scene, const Primitive* hit_primitive, const vec3& hit_point, int depth)
+{
+	Color color = BLACK;
+	Color throughput = WHITE;
+	Ray current = ray;
+	vec3 current_hit = hit_point;
+	while(true)
+	{
+		color = color + throughput * directLight(current, scene, hit_primitive, current_hit);
+		throughput = throughput * scene.material(hit_primitive).specular;
+		if(++depth > scene.max_depth || throughput.maxComponent() < scene.min_throughput)
+		{
+			break;
+		}
+		vec3 unit_normal = glm::normalize(hit_primitive->interpolatePointNormal(current_hit, scene.inversedTransform(hit_primitive)));
+		current = createReflectRay(current, current_hit, unit_normal);
+		STATS_COUNT(reflection_rays, 1);
+		if(!getIntersection(current, scene, hit_primitive, &current_hit))
+		{
+			break;
+		}
+	}
+	return color;
+}
+
+// Emission, ambient and the unshadowed lights at a single hit, without reflections
+Color RayTracer::directLight(const Ray& ray, const Scene& scene, const Primitive* hit_primitive, const vec3& hit_point)
+{
+	const Materials &materials = scene.material(hit_primitive);
+	Color color(materials.ambient + materials.emission);
 	for(unsigned int i = 0; i < scene.lights.size(); ++i)
 	{
+		bool shadowed;
 		if(scene.lights[i].type == Light::point)
 		{
-			Ray light_ray(scene.lights[i].position(), hit_point - scene.lights[i].position());
-			const primitive *tmp_primitive;
-			vec3 light_hit;
-
-			if(getIntersection(light_ray, scene, tmp_primitive, &light_hit))
-			{
-				if(isSameVector(hit_point, light_hit))
-				{
-					color = color + CalcLight(scene.lights[i], hit_primitive, ray, hit_point, scene.attenuation);
-				}
-			}
+			shadowed = occluded(hit_point, scene.lights[i].position(), scene);
 		}
 		else
 		{
-			color = color + CalcLight(scene.lights[i], hit_primitive, ray, hit_point, scene.attenuation);
+			shadowed = occluded(Ray(hit_point, glm::normalize(scene.lights[i].direction())), INF, scene);
+		}
+		if(!shadowed)
+		{
+			STATS_TIMER(shading);
+			color = color + calcLight(scene.lights[i], hit_primitive, scene, ray, hit_point, scene.attenuation);
 		}
-	}
-	if(!hit_primitive->materials.specular.isZero())
-	{
-		vec3 unit_normal = glm::normalize(hit_primitive->interpolatePointNormal(hit_point));
-		Ray reflect_ray = createReflectRay(ray, hit_point, unit_normal);
-		Color temp_color = Trace(reflect_ray, scene, depth+1, pixH, pixW);
-		color = color + hit_primitive->specular * temp_color;
 	}
 	return color;
 }
 
+// Blinn-Phong term of one unshadowed light. Point lights fall off with the scene's
+// constant, linear and quadratic attenuation, directional lights do not.
+Color RayTracer::calcLight(const Light &light, const Primitive *hit_primitive, const Scene &scene, const Ray &ray, const vec3 &hit_point, const float *attenuation)
+{
+	const Materials &materials = scene.material(hit_primitive);
+	vec3 normal = glm::normalize(hit_primitive->interpolatePointNormal(hit_point, scene.inversedTransform(hit_primitive)));
+	vec3 to_light;
+	float falloff = 1.0f;
+	if(light.type == Light::point)
+	{
+		to_light = light.position() - hit_point;
+		float dist = glm::length(to_light);
+		to_light = to_light / dist;
+		falloff = 1.0f / (attenuation[0] + attenuation[1] * dist + attenuation[2] * dist * dist);
+	}
+	else
+	{
+		to_light = glm::normalize(light.direction());
+	}
+	vec3 half_vector = glm::normalize(to_light - glm::normalize(ray.direction));
+	float lambert = std::max(glm::dot(normal, to_light), 0.0f);
+	float phong = pow(std::max(glm::dot(normal, half_vector), 0.0f), materials.shininess);
+	return light.color * falloff * (materials.diffuse * lambert + materials.specular * phong);
+}
 
+// Mirror direction about the normal. The ray starts on the surface, the primitives'
+// minimum hit distance keeps it from hitting the surface it leaves.
+Ray RayTracer::createReflectRay(const Ray &ray, const vec3 &hit, const vec3 &unit_normal)
+{
+	vec3 direction = glm::normalize(ray.direction);
+	return Ray(hit, direction - unit_normal * (2.0f * glm::dot(direction, unit_normal)));
+}
@@ -4,22 +4,76 @@
 #ifndef RAYTRACER_H
 #define RAYTRACER_H
 
+#include <deque>
+#include <limits>
 #include "scene.h"
+#include "camera.h"
+#include "packet.h"
+#include "stats.h"
+
+// Distance of a ray that hits nothing
+const float INF = std::numeric_limits<float>::infinity();
 
 class RayTracer
 {
 public:
-	Color trace(const Ray &ray, const Scene &scene, int depth, int i, int j);
+	Color trace(const Ray &ray, const Scene &scene, int depth);
+
+	// Lighting and reflection at a known hit, the part of trace after the intersection
+	Color shade(const Ray &ray, const Scene &scene, const Primitive *hit_primitive, const vec3 &hit_point, int depth);
+
+	Color directLight(const Ray &ray, const Scene &scene, const Primitive *hit_primitive, const vec3 &hit_point);
+
+	Ray generateRay(const CameraModel &camera, int i, int j);
+
+	// Rays through the 2x2 pixel block with top left corner (i, j)
+	RayPacket generatePacket(const CameraModel &camera, int i, int j);
 
-	Ray generateRay(const Camera &camera, int i, int j, int height, int width);
+	// Nearest hit of each active lane, hit_primitives[lane] is null on a miss
+	void intersectPacket(const RayPacket &packet, const Scene &scene, const Primitive **hit_primitives, vec3 *hit_points);
 
+	bool intersectSphere(const Ray &ray, const Scene &scene, const Sphere &sphere, vec3 *hit_point, float *dist);
+
+	// Hits inside instances are returned as copies owned by the tracer. They stay valid
+	// until the next trace from depth 0, intersectPacket or clearInstanceHits.
 	bool getIntersection(const Ray &ray, const Scene &scene, const Primitive *&hit_primitive, vec3 *hit_point);
 
-	Color calcLight(const Light &light, const Primitive *hit_primitive, const Ray &ray, const vec3 &hit_point, const float *attenuation);
+	// Nearest hit in one BVH closer than *nearest_dist, which is lowered to it
+	bool intersectBVH(const Ray &ray, const Scene &scene, const BVH &bvh, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point);
+
+	// Nearest hit over the 8 wide BVH of the scene, used when scene.traversal is wide
+	bool intersectWide(const Ray &ray, const Scene &scene, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point);
+
+	bool intersectLeaf(const Ray &ray, const Scene &scene, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives, const vector<int> &indices, int first, int count, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point);
+
+	bool intersectInstances(const Ray &ray, const Scene &scene, float *nearest_dist, const Primitive *&hit_primitive, vec3 *hit_point);
+
+	void clearInstanceHits();
 
-	Ray transformRay(const Ray &ray, const Primitive *primitive);
+	bool occluded(const vec3 &origin, const vec3 &target, const Scene &scene);
+
+	bool occluded(const Ray &ray, float max_dist, const Scene &scene);
+
+	bool occludedBVH(const Ray &ray, float max_dist, const Scene &scene, const BVH &bvh, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives);
+
+	bool occludedWide(const Ray &ray, float max_dist, const Scene &scene);
+
+	bool occludedLeaf(const Ray &ray, float max_dist, const Scene &scene, const TriangleBuffer &triangle_buffer, const PrimitiveView &primitives, const vector<int> &indices, int first, int count);
+
+	bool occludedInstances(const Ray &ray, float max_dist, const Scene &scene);
+
+	Color calcLight(const Light &light, const Primitive *hit_primitive, const Scene &scene, const Ray &ray, const vec3 &hit_point, const float *attenuation);
+
+	Ray transformRay(const Ray &ray, const mat4 &inversedtransform);
 
 	Ray createReflectRay(const Ray &ray, const vec3 &hit, const vec3 &unit_normal);
+
+private:
+	const Primitive *instanceHit(const Primitive *primitive, int transform_id);
+
+	// Deques so that earlier hits keep their address as more are added
+	deque<Triangle> instance_triangles;
+	deque<Sphere> instance_spheres;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,402 @@
+// Regression check program that renders small scenes two ways and compares the results
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+
+#include "Transform.h"
+#include "scene.h"
+#include "raytracer.h"
+#include "renderer.h"
+
+using namespace std;
+
+// Every check computes one scene two ways that must agree, through the same scene loading
+// and tile renderer as raytrace, and fails if any pixel differs by more than tolerance in
+// a channel or if the reference shows nothing. Run with make check; the exit status is
+// the number of failed checks.
+const float tolerance = 1e-3f;
+const int width = 64, height = 48;
+
+int failures = 0;
+
+string writeScene(const string &text) {
+  static int count = 0;
+  string filename = string(P_tmpdir) + "/raycheck_" + to_string(getpid()) + "_" + to_string(count++) + ".test";
+  ofstream file(filename.c_str());
+  file << text;
+  return filename;
+}
+
+void load(Scene &scene, const string &text) {
+  string filename = writeScene(text);
+  scene.readFile(filename);
+  remove(filename.c_str());
+}
+
+vector<Color> render(const Scene &scene, int num_threads, TileRenderer::Mode mode = TileRenderer::scalar) {
+  Framebuffer framebuffer;
+  TileRenderer(scene, num_threads, mode).render(framebuffer);
+  return framebuffer.pixels;
+}
+
+vector<Color> render(const string &text, int num_threads = 1, TileRenderer::Mode mode = TileRenderer::scalar) {
+  Scene scene;
+  load(scene, text);
+  return render(scene, num_threads, mode);
+}
+
+void report(const string &name, int lit, int differing, int total) {
+  if (lit == 0) {
+    printf("%-36s FAILED, the reference image is black\n", name.c_str());
+    failures++;
+  } else if (differing > 0) {
+    printf("%-36s FAILED, %d of %d pixels differ\n", name.c_str(), differing, total);
+    failures++;
+  } else {
+    printf("%-36s ok\n", name.c_str());
+  }
+}
+
+void compare(const string &name, const vector<Color> &expected, const vector<Color> &actual) {
+  int lit = 0, differing = 0;
+  for (unsigned int k = 0; k < expected.size(); k++) {
+    const Color &a = expected[k], &b = actual[k];
+    lit += !a.isZero();
+    differing += fabs(a.r - b.r) > tolerance || fabs(a.g - b.g) > tolerance || fabs(a.b - b.b) > tolerance;
+  }
+  report(name, lit, differing, expected.size());
+}
+
+// Nearest hit distance of every primary ray through the BVH against testing every
+// primitive of the scene, a pixel counts as lit where the primitives are hit
+void checkNearestHits(const string &name, const string &text) {
+  Scene scene;
+  load(scene, text);
+  RayTracer tracer;
+  CameraModel camera(scene.camera, scene.width, scene.height);
+  int lit = 0, differing = 0;
+  for (int i = 0; i < scene.height; i++) {
+    for (int j = 0; j < scene.width; j++) {
+      Ray ray = tracer.generateRay(camera, i, j);
+      float expected = INF;
+      for (unsigned int k = 0; k < scene.triangles.size(); k++) {
+        float t;
+        if (scene.triangles[k].intersect(ray, &t)) {
+          expected = min(expected, t * glm::length(ray.direction));
+        }
+      }
+      for (unsigned int k = 0; k < scene.spheres.size(); k++) {
+        vec3 hit;
+        float dist;
+        if (tracer.intersectSphere(ray, scene, scene.spheres[k], &hit, &dist)) {
+          expected = min(expected, dist);
+        }
+      }
+      const Primitive *primitive;
+      vec3 hit;
+      float actual = tracer.getIntersection(ray, scene, primitive, &hit) ? glm::length(hit - ray.o) : INF;
+      lit += expected < INF;
+      differing += expected < INF ? !(fabs(expected - actual) <= tolerance) : actual < INF;
+    }
+  }
+  report(name, lit, differing, scene.height * scene.width);
+}
+
+// Shadow rays from every primary hit to every light through the any hit query, against
+// the nearest hit along the same segment, a ray counts as lit where it is blocked
+void checkShadows(const string &name, const string &text) {
+  Scene scene;
+  load(scene, text);
+  RayTracer tracer;
+  CameraModel camera(scene.camera, scene.width, scene.height);
+  int lit = 0, differing = 0, total = 0;
+  for (int i = 0; i < scene.height; i++) {
+    for (int j = 0; j < scene.width; j++) {
+      const Primitive *primitive;
+      vec3 hit;
+      if (!tracer.getIntersection(tracer.generateRay(camera, i, j), scene, primitive, &hit)) {
+        continue;
+      }
+      for (unsigned int k = 0; k < scene.lights.size(); k++) {
+        const Light &light = scene.lights[k];
+        bool point = light.type == Light::point;
+        float max_dist = point ? glm::length(light.position() - hit) : INF;
+        Ray ray(hit, glm::normalize(point ? light.position() - hit : light.direction()));
+        const Primitive *blocker;
+        vec3 blocker_hit;
+        bool expected = tracer.getIntersection(ray, scene, blocker, &blocker_hit) && glm::length(blocker_hit - hit) < max_dist;
+        lit += expected;
+        differing += expected != tracer.occluded(ray, max_dist, scene);
+        total++;
+      }
+    }
+  }
+  report(name, lit, differing, total);
+}
+
+// A compiled copy of the scene renders the same as the text it came from
+void checkCompiled(const string &name, const string &text) {
+  string filename = writeScene(text);
+  string compiled = filename + ".rtscene";
+  Scene scene;
+  scene.readFile(filename);
+  scene.writeCompiled(compiled);
+  Scene cached;
+  cached.readCompiled(compiled);
+  remove(filename.c_str());
+  remove(compiled.c_str());
+  compare(name, render(scene, 1), render(cached, 1));
+}
+
+// A compiled scene whose references point outside its tables must be refused when
+// loaded, instead of being rendered out of bounds
+void checkCorruptCache(const string &name, const string &text, const function<void(Scene&)> &corrupt) {
+  Scene scene;
+  load(scene, text);
+  corrupt(scene);
+  string compiled = writeScene("");
+  scene.writeCompiled(compiled);
+  bool rejected = false;
+  try {
+    Scene cached;
+    cached.readCompiled(compiled);
+  } catch (int) {
+    rejected = true;
+  }
+  remove(compiled.c_str());
+  report(name, 1, !rejected, 1);
+}
+
+// Leaf ranges of a BVH in slot order, which fixes the tree whatever order its nodes are in
+vector<pair<int, int> > leafRanges(const BVH &bvh) {
+  vector<pair<int, int> > leaves;
+  for (unsigned int k = 0; k < bvh.nodes.size(); k++) {
+    if (bvh.nodes[k].isLeaf()) {
+      leaves.push_back(make_pair(bvh.nodes[k].first, bvh.nodes[k].count));
+    }
+  }
+  sort(leaves.begin(), leaves.end());
+  return leaves;
+}
+
+// The SAH build over enough boxes to split the top of the tree on the pool must split
+// them as a serial build does, into the same leaves with the same references
+void checkParallelBuild(const string &name, int num_threads) {
+  vector<AABB> bounds;
+  unsigned int seed = 1;
+  for (int k = 0; k < 40000; k++) {
+    float v[6];
+    for (int c = 0; c < 6; c++) {
+      seed = seed * 1664525u + 1013904223u;
+      v[c] = (seed >> 8) / float(1 << 24);
+    }
+    AABB box;
+    box.expand(vec3(v[0], v[1], v[2]) * 100.0f);
+    box.expand(vec3(v[0], v[1], v[2]) * 100.0f + vec3(v[3], v[4], v[5]));
+    bounds.push_back(box);
+  }
+  BVH serial, parallel;
+  serial.build(bounds);
+  ThreadPool pool(num_threads);
+  parallel.build(bounds, BVH::sah, &pool);
+  report(name, 1, serial.indices != parallel.indices || leafRanges(serial) != leafRanges(parallel), 1);
+}
+
+void writeHeader(ostringstream &out) {
+  out << "size " << width << " " << height << "\n";
+  out << "maxdepth 3\n";
+  out << "camera 0 3 9 0 0 0 0 1 0 45\n";
+  out << "point 0 6 6 0.8 0.8 0.8\n";
+  out << "directional 1 1 1 0.3 0.3 0.3\n";
+  out << "ambient 0.1 0.1 0.1\n";
+  out << "specular 0.3 0.3 0.3\n";
+  out << "shininess 20\n";
+}
+
+// A unit tetrahedron at the origin, vertices 0 to 3
+void writeTetrahedronVertices(ostringstream &out) {
+  out << "maxverts 4\n";
+  out << "vertex -0.5 0 -0.5\nvertex 0.5 0 -0.5\nvertex 0 0 0.5\nvertex 0 0.8 0\n";
+}
+
+void writeTetrahedron(ostringstream &out) {
+  out << "tri 0 2 1\ntri 0 1 3\ntri 1 2 3\ntri 2 0 3\n";
+}
+
+// Where piece k of a small cluster goes
+void writePlacement(ostringstream &out, int k) {
+  out << "translate " << (k % 3 - 1) * 1.6f << " " << (k / 3) * 0.5f - 0.5f << " " << -(k / 3) * 1.2f << "\n";
+  out << "rotate 0 1 0 " << k * 40 << "\n";
+  out << "scale 1 " << 1.0f + 0.2f * (k % 2) << " 1\n";
+}
+
+// Mirror floor, spheres, and tetrahedra under nested transforms
+string mixedScene() {
+  ostringstream out;
+  writeHeader(out);
+  writeTetrahedronVertices(out);
+  out << "maxvertnorms 4\n";
+  out << "vertexnormal -4 -1 -4 0 1 0\nvertexnormal 4 -1 -4 0 1 0\nvertexnormal 4 -1 4 0 1 0\nvertexnormal -4 -1 4 0 1 0\n";
+  out << "diffuse 0.2 0.2 0.3\nspecular 0.6 0.6 0.6\n";
+  out << "trinormal 0 2 1 0 2 1\ntrinormal 0 3 2 0 3 2\n";
+  out << "specular 0.3 0.3 0.3\n";
+  for (int k = 0; k < 6; k++) {
+    out << "diffuse " << 0.2f + 0.1f * k << " 0.5 " << 0.7f - 0.1f * k << "\n";
+    out << "pushTransform\n";
+    writePlacement(out, k);
+    writeTetrahedron(out);
+    out << "pushTransform\ntranslate 0 1.1 0\nscale 0.3 0.3 0.3\nsphere 0 0 0 1\npopTransform\n";
+    out << "popTransform\n";
+  }
+  return out.str();
+}
+
+// The same clusters as one object instanced six times, or written out six times
+string clusterScene(bool instanced) {
+  ostringstream out;
+  writeHeader(out);
+  writeTetrahedronVertices(out);
+  out << "diffuse 0.6 0.5 0.4\n";
+  string cluster = "pushTransform\nscale 1 1.2 1\n";
+  cluster += "tri 0 2 1\ntri 0 1 3\ntri 1 2 3\ntri 2 0 3\npopTransform\n";
+  cluster += "pushTransform\ntranslate 0 1.1 0\nsphere 0 0 0 0.3\npopTransform\n";
+  if (instanced) {
+    out << "beginObject cluster\n" << cluster << "endObject\n";
+  }
+  for (int k = 0; k < 6; k++) {
+    out << "pushTransform\n";
+    writePlacement(out, k);
+    out << (instanced ? "instance cluster\n" : cluster);
+    out << "popTransform\n";
+  }
+  return out.str();
+}
+
+// A tetrahedron and a sphere placed through translate, rotate and scale, or written
+// directly at the place the transforms must put them. The translation keeps every edge
+// off the pixel centres, where rounding alone would decide the hit
+string placementScene(bool transformed) {
+  ostringstream out;
+  writeHeader(out);
+  out << "maxverts 6\n";
+  out << "vertex 0 0 0\nvertex 1 0 0\nvertex 0 1 0\n";
+  // rotate 90 about z turns (x, y) into (-y, x), after the scale by 2 and before the translation
+  out << "vertex 0.7 -1.3 0.1\nvertex 0.7 0.7 0.1\nvertex -1.3 -1.3 0.1\n";
+  out << "diffuse 0.6 0.5 0.4\n";
+  if (transformed) {
+    out << "pushTransform\ntranslate 0.7 -1.3 0.1\nrotate 0 0 1 90\nscale 2 2 2\n";
+    out << "tri 0 1 2\nsphere 0.5 0 0 0.5\npopTransform\n";
+  } else {
+    out << "tri 3 4 5\nsphere 0.7 -0.3 0.1 1\n";
+  }
+  return out.str();
+}
+
+// Where ball k of the animation is after frame frames
+vec3 ballPosition(int k, int frame) {
+  float angle = 1.1f * k + 0.05f * frame * (1 + k % 3);
+  return vec3(2.0f * cos(angle), 0.4f * (k % 3) - 0.4f, 2.0f * sin(angle));
+}
+
+// Eight tetrahedra with a sphere each, every one under its own transform
+string animationScene(int frame) {
+  ostringstream out;
+  writeHeader(out);
+  writeTetrahedronVertices(out);
+  out << "diffuse 0.6 0.5 0.4\n";
+  for (int k = 0; k < 8; k++) {
+    vec3 p = ballPosition(k, frame);
+    out << "pushTransform\ntranslate " << p.x << " " << p.y << " " << p.z << "\n";
+    writeTetrahedron(out);
+    out << "sphere 0 1.1 0 0.3\npopTransform\n";
+  }
+  return out.str();
+}
+
+// Moves the balls of animationScene(0) on for frames frames with refits, the threshold
+// forcing a few rebuilds on the way, and compares with a fresh load of the last frame.
+// cached loads the animated scene through the compiled cache first, collapse scales
+// every ball to nothing for one frame halfway.
+void checkRefit(const string &name, Scene::Traversal traversal, bool cached, bool collapse) {
+  const int frames = 60;
+  Scene scene;
+  scene.animated = true;
+  scene.traversal = traversal;
+  scene.rebuild_threshold = 1.2f;
+  string filename = writeScene(animationScene(0));
+  if (cached) {
+    string compiled = filename + ".rtscene";
+    Scene text;
+    text.animated = true;
+    text.readFile(filename);
+    text.writeCompiled(compiled);
+    scene.readCompiled(compiled);
+    remove(compiled.c_str());
+  } else {
+    scene.readFile(filename);
+  }
+  remove(filename.c_str());
+  for (int frame = 1; frame <= frames; frame++) {
+    for (int k = 0; k < 8; k++) {
+      vec3 p = ballPosition(k, frame);
+      mat4 placement = glm::transpose(Transform::translate(p.x, p.y, p.z));
+      if (collapse && frame == frames / 2) {
+        placement = glm::transpose(Transform::scale(0, 0, 0));
+      }
+      scene.setTransform(scene.animated_transforms[k], placement);
+    }
+    scene.refit();
+  }
+  compare(name, render(animationScene(frames)), render(scene, 1));
+}
+
+int main() {
+  string mixed = mixedScene();
+  checkNearestHits("BVH vs every primitive", mixed);
+  checkShadows("any hit vs nearest hit shadows", mixed);
+  compare("1 vs 4 threads", render(mixed), render(mixed, 4));
+  compare("scalar vs packets", render(mixed), render(mixed, 1, TileRenderer::packets));
+#if defined(RT_WAVEFRONT)
+  compare("scalar vs wavefront", render(mixed), render(mixed, 1, TileRenderer::wavefront));
+#endif
+  compare("placed vs transformed", render(placementScene(false)), render(placementScene(true)));
+  Scene lbvh;
+  lbvh.bvh_quality = BVH::lbvh;
+  lbvh.build_threads = 4;
+  load(lbvh, mixed);
+  compare("SAH vs LBVH", render(mixed), render(lbvh, 1));
+  Scene wide;
+  wide.traversal = Scene::wide;
+  load(wide, mixed);
+  compare("binary vs wide BVH", render(mixed), render(wide, 1));
+  checkParallelBuild("1 vs 4 thread SAH build", 4);
+  string flattened = clusterScene(false), instanced = clusterScene(true);
+  compare("flattened vs instanced", render(flattened), render(instanced));
+  compare("flattened vs instanced packets", render(flattened), render(instanced, 1, TileRenderer::packets));
+  checkCompiled("text vs compiled cache", mixed);
+  checkCompiled("text vs compiled cache, instanced", instanced);
+  checkCorruptCache("corrupt cache is refused", mixed, [](Scene &scene) {
+    scene.triangles[0].material_id = scene.material_table.size();
+  });
+  checkCorruptCache("corrupt instance is refused", instanced, [](Scene &scene) {
+    scene.instances[0].object = scene.objects.size();
+  });
+  checkRefit("rebuild vs refit", Scene::binary, false, false);
+  checkRefit("rebuild vs refit, wide BVH", Scene::wide, false, false);
+  checkRefit("rebuild vs refit, compiled cache", Scene::binary, true, false);
+  checkRefit("rebuild vs refit through scale 0", Scene::binary, false, true);
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+  }
+  return failures;
+}
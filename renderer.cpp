@@ -0,0 +1,350 @@
+// Renderer cpp file that defines the tiled multithreaded render loop
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "renderer.h"
+#include "wavefront.h"
+
+namespace
+{
+	// Position inside the pixel of its k-th sample, from the R2 low discrepancy sequence
+	// so that any number of samples stays evenly spread and later samples fill the gaps
+	inline void sampleOffset(int k, float *dy, float *dx)
+	{
+		*dx = fmod(0.5f + 0.7548776662f * k, 1.0f);
+		*dy = fmod(0.5f + 0.5698402910f * k, 1.0f);
+	}
+
+	// Brightness as displayed, clamped like the 8 bit output
+	inline float luminance(const Color &color)
+	{
+		return 0.2126f * std::min(color.r, 1.0f) + 0.7152f * std::min(color.g, 1.0f) + 0.0722f * std::min(color.b, 1.0f);
+	}
+
+	struct PixelSamples
+	{
+		Color sum;
+		float luminance_sum, luminance_squares;
+		int count;
+
+		PixelSamples() : luminance_sum(0), luminance_squares(0), count(0) {}
+
+		void add(const Color &color)
+		{
+			float l = luminance(color);
+			sum = sum + color;
+			luminance_sum += l;
+			luminance_squares += l * l;
+			++count;
+		}
+
+		Color mean() const { return sum * (1.0f / count); }
+		float meanLuminance() const { return luminance_sum / count; }
+
+		// Standard error of the mean luminance
+		float error() const
+		{
+			float mean = luminance_sum / count;
+			float variance = std::max(luminance_squares / count - mean * mean, 0.0f);
+			return sqrt(variance / count);
+		}
+	};
+}
+
+TileRenderer::TileRenderer(const Scene &scene_, int num_threads, Mode mode_, int tile_size_) : scene(scene_), pool(num_threads), mode(mode_), tile_size(tile_size_)
+{
+	tiles_x = (scene.width + tile_size - 1) / tile_size;
+	tiles_y = (scene.height + tile_size - 1) / tile_size;
+}
+
+Tile TileRenderer::tileAt(int tile) const
+{
+	Tile rect;
+	rect.x0 = (tile % tiles_x) * tile_size;
+	rect.y0 = (tile / tiles_x) * tile_size;
+	rect.x1 = std::min(rect.x0 + tile_size, scene.width);
+	rect.y1 = std::min(rect.y0 + tile_size, scene.height);
+	return rect;
+}
+
+void TileRenderer::render(Framebuffer &framebuffer)
+{
+	STATS_TIMER(render);
+	framebuffer = Framebuffer(scene.width, scene.height);
+	CameraModel camera(scene.camera, scene.width, scene.height);
+	pool.parallelFor(tiles_x * tiles_y, [&](int index)
+	{
+		Tile tile = tileAt(index);
+		vector<Color> pixels(tile.width() * tile.height(), BLACK);
+		if(scene.antialiasing.enabled())
+		{
+			renderTileAdaptive(tile, camera, pixels);
+		}
+		else if(mode == packets)
+		{
+			renderTilePackets(tile, camera, pixels);
+		}
+#if defined(RT_WAVEFRONT)
+		else if(mode == wavefront)
+		{
+			renderTileWavefront(tile, camera, pixels);
+		}
+#endif
+		else
+		{
+			renderTile(tile, camera, pixels);
+		}
+		framebuffer.writeTile(tile, pixels);
+	});
+}
+
+void TileRenderer::renderTile(const Tile &tile, const CameraModel &camera, vector<Color> &pixels)
+{
+	RayTracer tracer;
+	for(int i = tile.y0; i < tile.y1; ++i)
+	{
+		// Step the direction along the scanline instead of rebuilding it per pixel
+		vec3 direction = camera.rowStart(i) + camera.column_step * (float)tile.x0;
+		for(int j = tile.x0; j < tile.x1; ++j, direction += camera.column_step)
+		{
+			pixels[tile.index(i, j)] = tracer.trace(Ray(camera.eye, direction), scene, 0);
+		}
+	}
+}
+
+// Tiles are walked in 2x2 blocks. Lanes past the image border stay inactive.
+void TileRenderer::renderTilePackets(const Tile &tile, const CameraModel &camera, vector<Color> &pixels)
+{
+	RayTracer tracer;
+	for(int i = tile.y0; i < tile.y1; i += 2)
+	{
+		for(int j = tile.x0; j < tile.x1; j += 2)
+		{
+			RayPacket packet = tracer.generatePacket(camera, i, j);
+			const Primitive *hit_primitives[RayPacket::size];
+			vec3 hit_points[RayPacket::size];
+			tracer.intersectPacket(packet, scene, hit_primitives, hit_points);
+			for(int lane = 0; lane < RayPacket::size; ++lane)
+			{
+				int pixel_i = i + lane / 2, pixel_j = j + lane % 2;
+				if(!(packet.active >> lane & 1) || pixel_i >= tile.y1 || pixel_j >= tile.x1 || hit_primitives[lane] == nullptr)
+				{
+					continue;
+				}
+				pixels[tile.index(pixel_i, pixel_j)] = tracer.shade(packet.ray(lane), scene, hit_primitives[lane], hit_points[lane], 0);
+			}
+		}
+	}
+}
+
+#if defined(RT_WAVEFRONT)
+void TileRenderer::renderTileWavefront(const Tile &tile, const CameraModel &camera, vector<Color> &pixels)
+{
+	WavefrontTracer tracer;
+	tracer.renderTile(scene, camera, tile, pixels);
+}
+#endif
+
+// Every pixel first gets the base sample count. Refinement then runs in rounds that
+// double the sample count of the pixels still in question: those whose samples disagree
+// or whose mean differs from a neighbour's by more than the threshold. Neighbours are
+// looked up inside the tile only, so tiles stay independent.
+void TileRenderer::renderTileAdaptive(const Tile &tile, const CameraModel &camera, vector<Color> &pixels)
+{
+	RayTracer tracer;
+	const Antialiasing &aa = scene.antialiasing;
+	vector<PixelSamples> samples(tile.width() * tile.height());
+
+	auto addSamples = [&](int i, int j, int count)
+	{
+		PixelSamples &pixel = samples[tile.index(i, j)];
+		for(int k = 0; k < count; ++k)
+		{
+			float dy, dx;
+			sampleOffset(pixel.count, &dy, &dx);
+			pixel.add(tracer.trace(camera.ray(i + dy, j + dx), scene, 0));
+		}
+	};
+	auto differs = [&](const PixelSamples &pixel, int i, int j)
+	{
+		if(i < tile.y0 || i >= tile.y1 || j < tile.x0 || j >= tile.x1)
+		{
+			return false;
+		}
+		return fabs(pixel.meanLuminance() - samples[tile.index(i, j)].meanLuminance()) > aa.threshold;
+	};
+
+	for(int i = tile.y0; i < tile.y1; ++i)
+	{
+		for(int j = tile.x0; j < tile.x1; ++j)
+		{
+			addSamples(i, j, aa.base_samples);
+		}
+	}
+
+	vector<char> refine(samples.size());
+	for(int count = aa.base_samples; count < aa.max_samples; )
+	{
+		int added = std::min(count, aa.max_samples - count);
+		bool any = false;
+		for(int i = tile.y0; i < tile.y1; ++i)
+		{
+			for(int j = tile.x0; j < tile.x1; ++j)
+			{
+				const PixelSamples &pixel = samples[tile.index(i, j)];
+				bool open = pixel.count == count && (pixel.error() > aa.threshold
+					|| differs(pixel, i - 1, j) || differs(pixel, i + 1, j) || differs(pixel, i, j - 1) || differs(pixel, i, j + 1));
+				refine[tile.index(i, j)] = open;
+				any = any || open;
+			}
+		}
+		if(!any)
+		{
+			break;
+		}
+		for(int i = tile.y0; i < tile.y1; ++i)
+		{
+			for(int j = tile.x0; j < tile.x1; ++j)
+			{
+				if(refine[tile.index(i, j)])
+				{
+					addSamples(i, j, added);
+				}
+			}
+		}
+		count += added;
+	}
+
+	for(unsigned int k = 0; k < samples.size(); ++k)
+	{
+		pixels[k] = samples[k].mean();
+	}
+}
+
+void TileRenderer::renderProgressive(Framebuffer &framebuffer, double budget, const function<void(const Framebuffer&)> &pass_done)
+{
+	STATS_TIMER(render);
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budget));
+	const Antialiasing &aa = scene.antialiasing;
+	int width = scene.width, height = scene.height;
+	CameraModel camera(scene.camera, width, height);
+	vector<PixelSamples> samples(width * height);
+	framebuffer = Framebuffer(width, height);
+
+	// Pixels not traced yet show the sample at the corner of their 2x2 or 4x4 block
+	auto resolve = [&]()
+	{
+		for(int i = 0; i < height; ++i)
+		{
+			for(int j = 0; j < width; ++j)
+			{
+				const PixelSamples *pixel = &samples[i * width + j];
+				if(pixel->count == 0)
+				{
+					pixel = &samples[(i & ~1) * width + (j & ~1)];
+				}
+				if(pixel->count == 0)
+				{
+					pixel = &samples[(i & ~3) * width + (j & ~3)];
+				}
+				framebuffer.at(i, j) = pixel->count > 0 ? pixel->mean() : BLACK;
+			}
+		}
+		pass_done(framebuffer);
+	};
+
+	// Tiles that start after the deadline are skipped, except in the first pass
+	for(int step = 4; step >= 1; step /= 2)
+	{
+		bool first = step == 4;
+		pool.parallelFor(tiles_x * tiles_y, [&](int index)
+		{
+			if(!first && Clock::now() > deadline)
+			{
+				return;
+			}
+			RayTracer tracer;
+			Tile tile = tileAt(index);
+			for(int i = tile.y0; i < tile.y1; ++i)
+			{
+				for(int j = tile.x0; j < tile.x1; ++j)
+				{
+					PixelSamples &pixel = samples[i * width + j];
+					if(i % step == 0 && j % step == 0 && pixel.count == 0)
+					{
+						// Sample 0 of the sequence, so refinement continues it from sample 1
+						float dy, dx;
+						sampleOffset(0, &dy, &dx);
+						pixel.add(tracer.trace(camera.ray(i + dy, j + dx), scene, 0));
+					}
+				}
+			}
+		});
+		resolve();
+		if(Clock::now() > deadline)
+		{
+			return;
+		}
+	}
+
+	// Supersampling rounds double the samples of the pixels that still differ from
+	// themselves or their neighbours, like the adaptive tile renderer but across tiles
+	int max_samples = aa.enabled() ? aa.max_samples : progressive_max_samples;
+	vector<char> refine(width * height);
+	for(int count = 1; count < max_samples; count *= 2)
+	{
+		auto differs = [&](float luminance, int i, int j)
+		{
+			return i >= 0 && i < height && j >= 0 && j < width && fabs(luminance - samples[i * width + j].meanLuminance()) > aa.threshold;
+		};
+		bool any = false;
+		for(int i = 0; i < height; ++i)
+		{
+			for(int j = 0; j < width; ++j)
+			{
+				const PixelSamples &pixel = samples[i * width + j];
+				float l = pixel.meanLuminance();
+				bool open = pixel.count == count && (pixel.error() > aa.threshold
+					|| differs(l, i - 1, j) || differs(l, i + 1, j) || differs(l, i, j - 1) || differs(l, i, j + 1));
+				refine[i * width + j] = open;
+				any = any || open;
+			}
+		}
+		if(!any)
+		{
+			return;
+		}
+		int added = std::min(count, max_samples - count);
+		pool.parallelFor(tiles_x * tiles_y, [&](int index)
+		{
+			if(Clock::now() > deadline)
+			{
+				return;
+			}
+			RayTracer tracer;
+			Tile tile = tileAt(index);
+			for(int i = tile.y0; i < tile.y1; ++i)
+			{
+				for(int j = tile.x0; j < tile.x1; ++j)
+				{
+					PixelSamples &pixel = samples[i * width + j];
+					for(int k = 0; k < added && refine[i * width + j]; ++k)
+					{
+						float dy, dx;
+						sampleOffset(pixel.count, &dy, &dx);
+						pixel.add(tracer.trace(camera.ray(i + dy, j + dx), scene, 0));
+					}
+				}
+			}
+		});
+		resolve();
+		if(Clock::now() > deadline)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+// Renderer header file that declares the tiled multithreaded render loop
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <vector>
+#include <functional>
+#include "scene.h"
+#include "threadpool.h"
+#include "raytracer.h"
+#include "framebuffer.h"
+
+using namespace std;
+
+class TileRenderer
+{
+public:
+	// scalar traces each pixel on its own, packets traces primary rays as 2x2 packets and
+	// shades per ray, wavefront traces each tile one bounce at a time. wavefront needs a
+	// build with RT_WAVEFRONT defined, other builds trace it as scalar.
+	enum Mode {scalar, packets, wavefront};
+
+	TileRenderer(const Scene &scene_, int num_threads, Mode mode_ = scalar, int tile_size_ = 32);
+
+	// Renders the whole image into framebuffer, resizing it to the scene. Scenes with
+	// antialiasing enabled are supersampled through the scalar tracer in every mode.
+	void render(Framebuffer &framebuffer);
+
+	// Refines the image in passes: one ray per 4x4 block, per 2x2 block, per pixel, then
+	// adaptive supersampling rounds. pass_done receives the current image after every
+	// pass. Rendering stops once budget seconds have elapsed, but the first pass always
+	// completes. Uses the scalar tracer.
+	void renderProgressive(Framebuffer &framebuffer, double budget, const function<void(const Framebuffer&)> &pass_done);
+
+	// Sample limit of the supersampling passes when the scene does not set one
+	static const int progressive_max_samples = 16;
+
+private:
+	Tile tileAt(int tile) const;
+
+	// The tile functions fill pixels, a row major buffer covering just the tile
+	void renderTile(const Tile &tile, const CameraModel &camera, vector<Color> &pixels);
+
+	void renderTilePackets(const Tile &tile, const CameraModel &camera, vector<Color> &pixels);
+
+#if defined(RT_WAVEFRONT)
+	void renderTileWavefront(const Tile &tile, const CameraModel &camera, vector<Color> &pixels);
+#endif
+
+	void renderTileAdaptive(const Tile &tile, const CameraModel &camera, vector<Color> &pixels);
+
+	const Scene &scene;
+	ThreadPool pool;
+	Mode mode;
+	int tile_size;
+	int tiles_x, tiles_y;
+};
+
+#endif
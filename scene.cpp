@@ -4,12 +4,16 @@
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 #include <deque>
 #include <stack>
+#include <memory>
 #include "Transform.h"
 #include "scene.h"
+#include "mappedfile.h"
+#include "stats.h"
 
 const vec3& Light::position() const
 {
@@ -21,17 +25,154 @@ const vec3& Light::direction() const
 	return pos_or_dir;
 }
 
+// m is in the column vector form Transform builds. Points are transformed as row
+// vectors (p * M), so it is transposed first, and multiplying it in from the left
+// makes it apply to the geometry before the transforms already on the stack.
 void rightMultiply(const mat4 &m, stack<mat4> &transform_stack)
 {
 	mat4 &t = transform_stack.top();
-	t = m * t;
+	t = glm::transpose(m) * t;
 }
 
-bool Scene::readvals(stringstream &s, const int numvals, float* values) 
+namespace
+{
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+	}
+
+	// Advances cursor past leading whitespace and returns the next token in [token, cursor)
+	const char *nextToken(const char *&cursor, const char *end)
+	{
+		while(cursor < end && isSpace(*cursor))
+		{
+			++cursor;
+		}
+		const char *token = cursor;
+		while(cursor < end && !isSpace(*cursor))
+		{
+			++cursor;
+		}
+		return token;
+	}
+
+	// Runs body(begin, end) over contiguous ranges covering [0, count), one per task of the pool
+	void forEachRange(ThreadPool *pool, int count, const function<void(int, int)> &body)
+	{
+		if(pool == NULL)
+		{
+			body(0, count);
+			return;
+		}
+		long long tasks = pool->size() * 4;
+		pool->parallelFor(tasks, [&](int task)
+		{
+			body(count * task / tasks, count * (task + 1) / tasks);
+		});
+	}
+
+	// FNV-1a, usable in case labels so commands dispatch through a single switch
+	constexpr unsigned int commandHash(const char *s, unsigned int h = 2166136261u)
+	{
+		return *s ? commandHash(s + 1, (h ^ (unsigned char)*s) * 16777619u) : h;
+	}
+
+	unsigned int commandHash(const char *s, const char *end)
+	{
+		unsigned int h = 2166136261u;
+		for(; s < end; ++s)
+		{
+			h = (h ^ (unsigned char)*s) * 16777619u;
+		}
+		return h;
+	}
+
+	const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	double scaleByPowerOfTen(double value, int exponent)
+	{
+		if(exponent >= -22 && exponent <= 22)
+		{
+			return exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+		}
+		return value * pow(10.0, exponent);
+	}
+
+	// Parses [sign] digits [. digits] [e [sign] digits] like operator >> does, without locale
+	// or stream overhead. Stops at the first character that is not part of the number.
+	bool parseFloat(const char *&cursor, const char *end, float *value)
+	{
+		while(cursor < end && isSpace(*cursor))
+		{
+			++cursor;
+		}
+		const char *p = cursor;
+		bool negative = false;
+		if(p < end && (*p == '+' || *p == '-'))
+		{
+			negative = (*p == '-');
+			++p;
+		}
+		unsigned long long mantissa = 0;
+		int exponent = 0, digits = 0;
+		for(; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+		{
+			if(mantissa < 1000000000000000000ull)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+			else
+			{
+				++exponent;
+			}
+		}
+		if(p < end && *p == '.')
+		{
+			for(++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+			{
+				if(mantissa < 1000000000000000000ull)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					--exponent;
+				}
+			}
+		}
+		if(digits == 0)
+		{
+			return false;
+		}
+		if(p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char *q = p + 1;
+			bool negative_exponent = false;
+			if(q < end && (*q == '+' || *q == '-'))
+			{
+				negative_exponent = (*q == '-');
+				++q;
+			}
+			if(q < end && *q >= '0' && *q <= '9')
+			{
+				int e = 0;
+				for(; q < end && *q >= '0' && *q <= '9'; ++q)
+				{
+					e = std::min(e * 10 + (*q - '0'), 100000);
+				}
+				exponent += negative_exponent ? -e : e;
+				p = q;
+			}
+		}
+		double result = scaleByPowerOfTen((double)mantissa, exponent);
+		*value = (float)(negative ? -result : result);
+		cursor = p;
+		return true;
+	}
+}
+
+bool Scene::readvals(const char *&cursor, const char *end, const int numvals, float* values) 
 {
   for (int i = 0; i < numvals; i++) {
-    s >> values[i]; 
-    if (s.fail()) {
+    if (!parseFloat(cursor, end, &values[i])) {
       cout << "Failed reading value " << i << " will skip\n"; 
       return false;
     }
@@ -39,260 +180,716 @@ bool Scene::readvals(stringstream &s, const int numvals, float* values)
   return true; 
 }
 
-void Scene::readfile(const string &filename)
+// The file is memory mapped and parsed in place: no per line strings or streams,
+// and commands are dispatched on a hash of their token.
+void Scene::readFile(const string &filename)
+{
+	parse(filename);
+	finalize();
+}
+
+void Scene::parse(const string &filename)
 {
-	string str, cmd;
-	ifstream in;
-	in.open(filename.c_str());
-	if (in.is_open()) 
+	STATS_TIMER(parse);
+	MappedFile file;
+	if(!file.open(filename)) 
 	{
-		stack<mat4> transform_stack;
-		transform_stack.push(mat4(1.0));
+    	cerr << "Unable to Open Input Data File " << filename << "\n"; 
+    	throw 2; 
+  	}
+
+	stack<mat4> transform_stack;
+	transform_stack.push(mat4(1.0));
+	// Table entries for the current material and transform, -1 once the state changed
+	int material_id = -1, transform_id = -1;
+	// Object being defined, -1 outside beginObject/endObject, and the stack depth it started at
+	int object = -1;
+	size_t object_stack_size = 0;
 
-		getline(in, str);
-		while(in)
+	const char *line = file.data();
+	const char *file_end = line + file.size();
+	while(line < file_end)
+	{
+		const char *line_end = static_cast<const char*>(memchr(line, '\n', file_end - line));
+		if(line_end == nullptr)
 		{
-			if ((str.find_first_not_of(" \t\r\n") != string::npos) && (str[0] != '#')) 
-			{
-		        // Ruled out comment and blank lines 
-		        stringstream s(str);
-		        s >> cmd; 
-		        int i; 
-		        float values[10]; // Position and color for light, colors for others
-		        // Up to 10 params for cameras.  
-		        bool validinput; // Validity of input
-
-		        if(cmd == "output")
-		        {
-		        	s >> outputfile;
-		        } 
-		        // Process the light, add it to database.
-        		// Lighting Command
-		        else if((cmd == "directional") || (cmd == "point")) 
-		        {
-		        	validinput = readvals(s, 6, values);
-		        	if(validinput)
-		        	{
-		        		Light light;
-		        		light.pos_or_dir = vec3(values[0], values[1], values[2]);
-		        		light.color = Color(values[3], values[4], values[5]);
-		        		if(cmd == "directional")
-		        		{
-		        			light.type = Light::directional;
-		        		}
-		        		else if(cmd == "point")
-		        		{
-		        			light.type = Light::point;
-		        		}
-		        		lights.push_back(light);
-		        	}
-				}
-				else if(cmd == "attenuation")
+			line_end = file_end;
+		}
+		const char *cursor = line;
+		const char *cmd = nextToken(cursor, line_end);
+		// Ruled out comment and blank lines 
+		if((cmd != cursor) && (*line != '#'))
+		{
+	        float values[10]; // Position and color for light, colors for others
+	        // Up to 10 params for cameras.  
+	        bool validinput; // Validity of input
+	        unsigned int hash = commandHash(cmd, cursor);
+	        size_t length = cursor - cmd;
+	        // Hashes of unknown tokens may collide with a command, so confirm the spelling
+	        auto matches = [&](const char *name) { return length == strlen(name) && memcmp(cmd, name, length) == 0; };
+	        #define COMMAND(name) case commandHash(name): if(!matches(name)) goto unknown;
+
+	        switch(hash)
+	        {
+	        COMMAND("output")
+	        {
+	        	const char *token = nextToken(cursor, line_end);
+	        	outputfile.assign(token, cursor);
+	        	break;
+	        }
+	        // Process the light, add it to database.
+    		// Lighting Command
+	        case commandHash("directional"):
+	        case commandHash("point"):
+	        {
+	        	if(!matches("directional") && !matches("point"))
+	        	{
+	        		goto unknown;
+	        	}
+	        	validinput = readvals(cursor, line_end, 6, values);
+	        	if(validinput)
+	        	{
+	        		Light light;
+	        		light.pos_or_dir = vec3(values[0], values[1], values[2]);
+	        		light.color = Color(values[3], values[4], values[5]);
+	        		light.type = (*cmd == 'd') ? Light::directional : Light::point;
+	        		lights.push_back(light);
+	        	}
+	        	break;
+	        }
+	        COMMAND("attenuation")
+	        {
+				validinput = readvals(cursor, line_end, 3, values);
+				if(validinput)
 				{
-					validinput = readvals(s, 3, values);
-					if(validinput)
+					for(unsigned int i = 0; i < 3; ++i)
 					{
-						for(unsigned int i = 0; i < 3; ++i)
-						{
-							attenuation[i] = values[i];
-						}
+						attenuation[i] = values[i];
 					}
 				}
-				// Material Commands 
-		        // Ambient, diffuse, specular, shininess properties for each object.
-		        // Filling this in is pretty straightforward, so I've left it in 
-		        // the skeleton, also as a hint of how to do the more complex ones.
-		        // Note that no transforms/stacks are applied to the colors. 
-
-		        else if(cmd == "ambient") 
-		        {
-					validinput = readvals(s, 3, values); // colors 
-					if(validinput) 
-					{
-						materials.ambient = Color(values[0], values[1], values[2]); 
-					}
-		        } 
-		        else if(cmd == "diffuse") 
-		        {
-					validinput = readvals(s, 3, values); 
-					if(validinput) 
-					{
-						materials.diffuse = Color(values[0], values[1], values[2]);
-					}
-		        } 
-		        else if(cmd == "specular") 
-		        {
-					validinput = readvals(s, 3, values); 
-					if(validinput) 
-					{
-						materials.specular = Color(values[0], values[1], values[2]);
-					}
-		        } 
-		        else if(cmd == "emission") 
-		        {
-					validinput = readvals(s, 3, values); 
-					if(validinput) 
-					{
-						materials.emission = Color(values[0], values[1], values[2]);
-					}
-		        } 
-		        else if(cmd == "shininess") 
-		        {
-					validinput = readvals(s, 1, values); 
-					if (validinput) 
-					{
-						materials.shininess = values[0];
-					}
-		        } 
-		        else if(cmd == "size") 
-		        {
-					validinput = readvals(s,2,values); 
-					if(validinput) 
-					{ 
-						width = (int) values[0]; 
-						height = (int) values[1]; 
-					} 
-		        } 
-		        else if(cmd == "camera") 
-		        {
-					validinput = readvals(s, 10, values); // 10 values eye cen up fov
-					if(validinput) 
+				break;
+			}
+			// Material Commands 
+	        // Ambient, diffuse, specular, shininess properties for each object.
+	        // Note that no transforms/stacks are applied to the colors. 
+	        COMMAND("ambient")
+	        {
+				validinput = readvals(cursor, line_end, 3, values); // colors 
+				if(validinput) 
+				{
+					materials.ambient = Color(values[0], values[1], values[2]);
+					material_id = -1;
+				}
+				break;
+	        } 
+	        COMMAND("diffuse")
+	        {
+				validinput = readvals(cursor, line_end, 3, values); 
+				if(validinput) 
+				{
+					materials.diffuse = Color(values[0], values[1], values[2]);
+					material_id = -1;
+				}
+				break;
+	        } 
+	        COMMAND("specular")
+	        {
+				validinput = readvals(cursor, line_end, 3, values); 
+				if(validinput) 
+				{
+					materials.specular = Color(values[0], values[1], values[2]);
+					material_id = -1;
+				}
+				break;
+	        } 
+	        COMMAND("emission")
+	        {
+				validinput = readvals(cursor, line_end, 3, values); 
+				if(validinput) 
+				{
+					materials.emission = Color(values[0], values[1], values[2]);
+					material_id = -1;
+				}
+				break;
+	        } 
+	        COMMAND("shininess")
+	        {
+				validinput = readvals(cursor, line_end, 1, values); 
+				if (validinput) 
+				{
+					materials.shininess = values[0];
+					material_id = -1;
+				}
+				break;
+	        } 
+	        COMMAND("size")
+	        {
+				validinput = readvals(cursor, line_end, 2, values); 
+				if(validinput) 
+				{ 
+					width = (int) values[0]; 
+					height = (int) values[1]; 
+				} 
+				break;
+	        } 
+	        COMMAND("camera")
+	        {
+				validinput = readvals(cursor, line_end, 10, values); // 10 values eye cen up fov
+				if(validinput) 
+				{
+					camera.eye = vec3(values[0], values[1], values[2]);
+					camera.center = vec3(values[3], values[4], values[5]);
+					camera.up = vec3(values[6], values[7], values[8]);
+					camera.fovy = values[9];
+				}
+				break;
+	        }
+	        COMMAND("maxdepth")
+	        {
+	        	validinput = readvals(cursor, line_end, 1, values);
+	        	if(validinput)
+	        	{
+	        		max_depth = values[0];
+	        	}
+	        	break;
+	        }
+	        COMMAND("antialias")
+	        {
+	        	validinput = readvals(cursor, line_end, 3, values); // base samples, max samples, threshold
+	        	if(validinput)
+	        	{
+	        		antialiasing.base_samples = std::max((int) values[0], 1);
+	        		antialiasing.max_samples = std::max((int) values[1], antialiasing.base_samples);
+	        		antialiasing.threshold = values[2];
+	        	}
+	        	break;
+	        }
+	        COMMAND("vertex")
+	        {
+	        	validinput = readvals(cursor, line_end, 3, values);
+	        	if(validinput)
+	        	{
+	        		vertex_buffer.push_back(vec3(values[0], values[1], values[2]));
+	        	}
+	        	break;
+	        }
+	        COMMAND("vertexnormal")
+	        {
+	        	validinput = readvals(cursor, line_end, 6, values);
+	        	if(validinput)
+	        	{
+	        		vertex_buffer_with_normal.push_back(vec3(values[0], values[1], values[2]));
+	        		vertex_normal_buffer.push_back(vec3(values[3], values[4], values[5]));
+	        	}
+	        	break;
+	        }
+	        COMMAND("tri")
+	        {
+	        	validinput = readvals(cursor, line_end, 3, values);
+	        	if(validinput)
+	        	{
+	        		Triangle triangle(vertex_buffer[values[0]], vertex_buffer[values[1]], vertex_buffer[values[2]]);
+	        		assignState(triangle, transform_stack.top(), object < 0, material_id, transform_id);
+	        		(object >= 0 ? objects[object].triangles : triangles).push_back(triangle);
+	        	}
+	        	break;
+	        }
+	        COMMAND("trinormal")
+	        {
+	        	validinput = readvals(cursor, line_end, 6, values);
+	        	if(validinput)
+	        	{
+	        		Triangle triangle(vertex_buffer_with_normal[values[0]], vertex_buffer_with_normal[values[1]], vertex_buffer_with_normal[values[2]], vertex_normal_buffer[values[3]], vertex_normal_buffer[values[4]], vertex_normal_buffer[values[5]]);
+	        		assignState(triangle, transform_stack.top(), object < 0, material_id, transform_id);
+	        		(object >= 0 ? objects[object].triangles : triangles).push_back(triangle);
+	        	}
+	        	break;
+	        }
+	        COMMAND("sphere")
+	        {
+	        	validinput = readvals(cursor, line_end, 4, values);
+	        	if(validinput)
+	        	{
+	        		Sphere sphere(vec3(values[0], values[1], values[2]), values[3]);
+	        		assignState(sphere, transform_stack.top(), object < 0, material_id, transform_id);
+	        		(object >= 0 ? objects[object].spheres : spheres).push_back(sphere);
+	        	}
+	        	break;
+	        }
+	        case commandHash("maxverts"):
+	        case commandHash("maxvertnorms"):
+	        {
+	        	if(!matches("maxverts") && !matches("maxvertnorms"))
+	        	{
+	        		goto unknown;
+	        	}
+	        	break;
+	        }
+	        COMMAND("translate")
+	        {
+	        	validinput = readvals(cursor, line_end, 3, values);
+	        	if(validinput)
+	        	{
+	        		rightMultiply(Transform::translate(values[0], values[1], values[2]), transform_stack);
+	        		transform_id = -1;
+	        	}
+	        	break;
+	        }
+	        COMMAND("scale")
+	        {
+	        	validinput = readvals(cursor, line_end, 3, values);
+	        	if(validinput)
+	        	{
+	        		rightMultiply(Transform::scale(values[0], values[1], values[2]), transform_stack);
+	        		transform_id = -1;
+	        	}
+	        	break;
+	        }
+	        COMMAND("rotate")
+	        {
+	        	validinput = readvals(cursor, line_end, 4, values);
+	        	if(validinput)
+	        	{
+	        		rightMultiply(glm::mat4(Transform::rotate(-values[3], vec3(values[0], values[1], values[2]))), transform_stack);
+	        		transform_id = -1;
+	        	}
+	        	break;
+	        }
+	        // I include the basic push/pop code for matrix stacks
+			COMMAND("pushTransform")
+			{
+				transform_stack.push(transform_stack.top()); 
+				break;
+			} 
+			COMMAND("popTransform")
+			{
+				if(transform_stack.size() <= (object >= 0 ? object_stack_size : 1)) 
+				{
+					cerr << "Stack has no elements.  Cannot Pop\n"; 
+				} 
+				else 
+				{
+					transform_stack.pop(); 
+					transform_id = -1;
+				}
+				break;
+			}
+			// Instancing. Geometry between beginObject and endObject is stored once in the
+			// object's own frame, instance places it with the current transform.
+			COMMAND("beginObject")
+			{
+				const char *token = nextToken(cursor, line_end);
+				string name(token, cursor);
+				if(object >= 0)
+				{
+					cerr << "Objects cannot be nested, skipping " << name << "\n";
+				}
+				else if(name.empty() || object_ids.count(name) > 0)
+				{
+					cerr << "Object " << name << " needs a new name, skipping\n";
+				}
+				else
+				{
+					object = objects.size();
+					objects.push_back(Object());
+					object_ids[name] = object;
+					transform_stack.push(mat4(1.0));
+					object_stack_size = transform_stack.size();
+					transform_id = -1;
+				}
+				break;
+			}
+			COMMAND("endObject")
+			{
+				if(object < 0)
+				{
+					cerr << "endObject without beginObject\n";
+				}
+				else
+				{
+					// Transforms pushed inside the object end with it
+					while(transform_stack.size() >= object_stack_size)
 					{
-						camera.eye = vec3(values[0], values[1], values[2]);
-						camera.center = vec3(values[3], values[4], values[5]);
-						camera.up = vec3(values[6], values[7], values[8]);
-						camera.fovy = values[9];
+						transform_stack.pop();
 					}
-		        }
-		        else if(cmd == "maxdepth")
-		        {
-		        	validinput = readvals(s, 1, values);
-		        	if(validinput)
-		        	{
-		        		max_depth = values[0];
-		        	}
-		        }
-		        else if(cmd == "vertex")
-		        {
-		        	validinput = readvals(s, 3, values);
-		        	if(validinput)
-		        	{
-		        		vertex_buffer.push_back(vec3(values[0], values[1], values[2]));
-		        	}
-		        }
-		        else if(cmd == "vertexnormal")
-		        {
-		        	validinput = readvals(s, 6, values);
-		        	if(validinput)
-		        	{
-		        		vertex_buffer_with_normal.push_back(vec3(values[0], values[1], values[2]));
-		        		vertex_normal_buffer.push_back(vec3(values[3], values[4], values[5]));
-		        	}
-		        }
-		        else if(cmd == "tri")
-		        {
-		        	validinput = readvals(s, 3, values);
-		        	if(validinput)
-		        	{
-		        		Triangle *triangle = new Triangle(vertex_buffer[values[0]], vertex_buffer[values[1]], vertex_buffer[values[2]]);
-		        		triangle->index = primitives.size();
-		        		triangle->materials = materials;
-		        		triangle->transform = transform_stack.top();
-		        		triangle->inversed_transform = glm::inverse(transform_stack.top());
-		        		primitives.push_back(triangle);
-		        	}
-		        }
-		        else if(cmd == "trinormal")
-		        {
-		        	validinput = readvals(s, 6, values);
-		        	if(validinput)
-		        	{
-		        		Triangle *triangle = new Triangle(vertex_buffer_with_normal[values[0]], vertex_buffer_with_normal[values[1]], vertex_buffer_with_normal[values[2]], vertex_normal_buffer[values[3]], vertex_normal_buffer[values[4]], vertex_normal_buffer[values[5]]);
-		        		triangle->index = primitives.size();
-		        		triangle->materials = materials;
-		        		triangle->transform = transform_stack.top();
-		        		triangle->inversed_transform = glm::inverse(transform_stack.top());
-		        		primitives.push_back(triangle);
-		        	}
-		        }
-		        else if(cmd == "sphere")
-		        {
-		        	validinput = readvals(s, 4, values);
-		        	if(validinput)
-		        	{
-		        		Sphere *sphere = new Sphere(values[0], values[1], values[2], values[3]);
-		        		sphere->index = primitives.size();
-		        		sphere->materials = materials;
-		        		sphere->transform = transform_stack.top();
-		        		triangle->inversed_transform = glm::inverse(transform_stack.top());
-		        		primitives.push_back(sphere);
-		        	}
-		        }
-		        else if((cmd == "maxverts") || (cmd == "maxvertnorms"))
-		        {
-
-		        }
-		        else if(cmd == "translate")
-		        {
-		        	validinput = readvals(s, 3, values);
-		        	if(validinput)
-		        	{
-		        		rightMultiply(Transform::translate(values[0], values[1], values[2]), transfstack);
-		        	}
-		        }
-		        else if(cmd == "scale")
-		        {
-		        	validinput = readvals(s, 3, values);
-		        	if(validinput)
-		        	{
-		        		rightMultiply(Transform::scale(values[0], values[1], values[2]), transfstack);
-		        	}
-		        }
-		        else if(cmd == "rotate")
-		        {
-		        	validinput = readvals(s, 4, values);
-		        	if(validinput)
-		        	{
-		        		rightMultiply(glm::mat4(Transform::rotate(-values[3], vec3(values[0], values[1], values[2]))), transfstack);
-		        	}
-		        }
-		        // I include the basic push/pop code for matrix stacks
-				else if(cmd == "pushTransform") 
+					object = -1;
+					transform_id = -1;
+				}
+				break;
+			}
+			COMMAND("instance")
+			{
+				const char *token = nextToken(cursor, line_end);
+				string name(token, cursor);
+				unordered_map<string, int>::const_iterator it = object_ids.find(name);
+				if(object >= 0)
 				{
-					transfstack.push(transfstack.top()); 
-				} 
-				else if(cmd == "popTransform") 
+					cerr << "Instances inside objects are not supported, skipping " << name << "\n";
+				}
+				else if(it == object_ids.end())
+				{
+					cerr << "Unknown object " << name << ", skipping instance\n";
+				}
+				else if(!objects[it->second].empty())
 				{
-					if(transfstack.size() <= 1) 
+					// Instances are not animated. The cached entry of an animated scene
+					// belongs to the geometry of this state and moves with it, so they
+					// take the interned entry of the matrix instead.
+					int instance_transform;
+					if(animated)
 					{
-						cerr << "Stack has no elements.  Cannot Pop\n"; 
-					} 
-					else 
+						instance_transform = addTransform(transform_stack.top());
+					}
+					else
 					{
-						transfstack.pop(); 
+						if(transform_id < 0)
+						{
+							transform_id = addTransform(transform_stack.top());
+						}
+						instance_transform = transform_id;
 					}
+					Instance instance = {it->second, instance_transform, 0};
+					instances.push_back(instance);
 				}
-				else 
-				{
-          			cerr << "Unknown Command: " << cmd << " Skipping \n"; 
-        		}
+				break;
 			}
-			getline(in, str);
+			default:
+			unknown:
+			{
+      			cerr << "Unknown Command: " << string(cmd, length) << " Skipping \n"; 
+      			break;
+    		}
+	        }
+	        #undef COMMAND
 		}
+		line = line_end + 1;
+	}
+}
+
+// Adds the current material and transform to their tables the first time a
+// primitive is created after the state changed, and points the primitive at them.
+// Top level geometry of an animated scene gets a transform entry of its own.
+void Scene::assignState(Primitive &primitive, const mat4 &transform, bool top_level, int &material_id, int &transform_id)
+{
+	if(material_id < 0)
+	{
+		material_id = addMaterial(materials);
 	}
-	else 
+	if(transform_id < 0)
 	{
-    	cerr << "Unable to Open Input Data File " << filename << "\n"; 
-    	throw 2; 
-  	}
+		transform_id = animated && top_level ? appendTransform(transform) : addTransform(transform);
+	}
+	primitive.material_id = material_id;
+	primitive.transform_id = transform_id;
+}
+
+// Returns the table entry for a material, adding it only if no identical one exists yet.
+// Meshes that switch between a few materials, or restate the current one, share entries.
+int Scene::addMaterial(const Materials &state)
+{
+	unordered_map<Materials, int, MaterialsHash>::const_iterator it = material_ids.find(state);
+	if(it != material_ids.end())
+	{
+		return it->second;
+	}
+	int id = material_table.size();
+	material_table.push_back(state);
+	material_ids[state] = id;
+	return id;
+}
+
+// Interns a transform so every distinct matrix is stored and inverted exactly once,
+// however many pushTransform/popTransform blocks produce it.
+int Scene::addTransform(const mat4 &transform)
+{
+	unordered_map<mat4, int, Mat4BitsHash, Mat4BitsEqual>::const_iterator it = transform_ids.find(transform);
+	if(it != transform_ids.end())
+	{
+		return it->second;
+	}
+	int id = transforms.size();
+	transforms.push_back(transform);
+	inversed_transforms.push_back(glm::inverse(transform));
+	transform_ids[transform] = id;
+	return id;
+}
+
+// Adds an entry of its own for a transform of an animated scene. It is not interned, so
+// moving it never moves geometry that only happened to start out with the same matrix.
+int Scene::appendTransform(const mat4 &transform)
+{
+	int id = transforms.size();
+	transforms.push_back(transform);
+	inversed_transforms.push_back(glm::inverse(transform));
+	animated_transforms.push_back(id);
+	return id;
+}
+
+// Scene is read-only from here on. Bake triangle transforms, lay out the
+// primitive view over the arena, build the acceleration structure and pack
+// the triangles in its leaf order once.
+void Scene::finalize()
+{
+	STATS_TIMER(build);
+	unique_ptr<ThreadPool> pool(build_threads > 1 ? new ThreadPool(build_threads) : NULL);
+	if(animated && rest_triangles.empty())
+	{
+		rest_triangles = triangles;
+	}
+	if(animated)
+	{
+		findAnimatedRanges();
+	}
+	forEachRange(pool.get(), triangles.size(), [&](int begin, int end)
+	{
+		for(int i = begin; i < end; ++i)
+		{
+			triangles[i].toWorldSpace(transforms[triangles[i].transform_id], inversed_transforms[triangles[i].transform_id]);
+		}
+	});
+
+	buildPrimitiveView();
+
+	vector<AABB> bounds(primitives.size());
+	forEachRange(pool.get(), primitives.size(), [&](int begin, int end)
+	{
+		for(int i = begin; i < end; ++i)
+		{
+			bounds[i] = primitives[i]->bounds(transform(primitives[i]));
+		}
+	});
+	bvh.build(bounds, bvh_quality, pool.get());
+	if(animated)
+	{
+		primitive_bounds.swap(bounds);
+	}
+	buildFromBVH();
+
+	// Object triangles are baked into the object's frame, which is their world
+	for(unsigned int k = 0; k < objects.size(); ++k)
+	{
+		Object &object = objects[k];
+		for(unsigned int i = 0; i < object.triangles.size(); ++i)
+		{
+			Triangle &triangle = object.triangles[i];
+			triangle.toWorldSpace(transforms[triangle.transform_id], inversed_transforms[triangle.transform_id]);
+		}
+		object.buildPrimitiveView();
+
+		vector<AABB> object_bounds(object.primitives.size());
+		unordered_map<int, int> slots;
+		object.transform_ids.clear();
+		object.transform_slots.resize(object.primitives.size());
+		for(unsigned int i = 0; i < object.primitives.size(); ++i)
+		{
+			const Primitive *primitive = object.primitives[i];
+			object_bounds[i] = primitive->bounds(transform(primitive));
+			unordered_map<int, int>::const_iterator it = slots.find(primitive->transform_id);
+			if(it == slots.end())
+			{
+				it = slots.insert(make_pair(primitive->transform_id, (int)object.transform_ids.size())).first;
+				object.transform_ids.push_back(primitive->transform_id);
+			}
+			object.transform_slots[i] = it->second;
+		}
+		object.bvh.build(object_bounds, bvh_quality, pool.get());
+		object.triangle_buffer.build(object.primitives, object.bvh.indices);
+	}
+
+	// Points go through the object's own transforms first, then the instance's
+	instance_transforms.clear();
+	vector<AABB> instance_bounds(instances.size());
+	for(unsigned int k = 0; k < instances.size(); ++k)
+	{
+		Instance &instance = instances[k];
+		const Object &object = objects[instance.object];
+		instance.first_transform = instance_transforms.size();
+		for(unsigned int i = 0; i < object.transform_ids.size(); ++i)
+		{
+			mat4 composed = transforms[object.transform_ids[i]] * transforms[instance.transform_id];
+			instance_transforms.push_back(addTransform(composed));
+		}
+		const AABB &box = object.bvh.nodes[0].box;
+		for(int corner = 0; corner < 8; ++corner)
+		{
+			vec3 p(corner & 1 ? box.hi.x : box.lo.x, corner & 2 ? box.hi.y : box.lo.y, corner & 4 ? box.hi.z : box.lo.z);
+			instance_bounds[k].expand(transformPoint(p, transforms[instance.transform_id]));
+		}
+	}
+	instance_bvh.build(instance_bounds, bvh_quality, pool.get());
+}
+
+// Blinn-Phong terms are at most (diffuse + specular) times the light's color and
+// falloff, and with non-negative coefficients a point light's falloff is at most
+// 1 / attenuation[0]
+float Scene::maxRadiance() const
+{
+	float point_falloff = 1.0f;
+	for(unsigned int k = 0; k < lights.size(); ++k)
+	{
+		if(lights[k].type == Light::point)
+		{
+			if(attenuation[0] <= 0.0f || attenuation[1] < 0.0f || attenuation[2] < 0.0f)
+			{
+				return INFINITY;
+			}
+			point_falloff = 1.0f / attenuation[0];
+		}
+	}
+	float radiance = 0.0f;
+	for(unsigned int i = 0; i < material_table.size(); ++i)
+	{
+		const Materials &materials = material_table[i];
+		Color color = materials.ambient + materials.emission;
+		for(unsigned int k = 0; k < lights.size(); ++k)
+		{
+			float falloff = lights[k].type == Light::point ? point_falloff : 1.0f;
+			color = color + lights[k].color * falloff * (materials.diffuse + materials.specular);
+		}
+		radiance = max(radiance, color.maxComponent());
+	}
+	return radiance;
+}
+
+// Index of the range of an animated transform, -1 for any other entry. appendTransform
+// hands out ids in increasing order, so animated_transforms is sorted.
+int Scene::animatedRange(int transform_id) const
+{
+	vector<int>::const_iterator it = lower_bound(animated_transforms.begin(), animated_transforms.end(), transform_id);
+	return it != animated_transforms.end() && *it == transform_id ? it - animated_transforms.begin() : -1;
+}
+
+// The parser creates the geometry of each transform state in one go, so every range is
+// contiguous in both arrays. Primitives under any other entry belong to no range.
+void Scene::findAnimatedRanges()
+{
+	AnimatedRange empty = {0, 0, 0, 0, false};
+	animated_ranges.assign(animated_transforms.size(), empty);
+	for(unsigned int i = 0; i < rest_triangles.size(); ++i)
+	{
+		int range = animatedRange(rest_triangles[i].transform_id);
+		if(range >= 0 && animated_ranges[range].triangle_count++ == 0)
+		{
+			animated_ranges[range].first_triangle = i;
+		}
+	}
+	for(unsigned int i = 0; i < spheres.size(); ++i)
+	{
+		int range = animatedRange(spheres[i].transform_id);
+		if(range >= 0 && animated_ranges[range].sphere_count++ == 0)
+		{
+			animated_ranges[range].first_sphere = i;
+		}
+	}
+}
+
+void Scene::setTransform(int transform_id, const mat4 &transform)
+{
+	transforms[transform_id] = transform;
+	inversed_transforms[transform_id] = glm::inverse(transform);
+	int range = animatedRange(transform_id);
+	if(range >= 0 && range < (int)animated_ranges.size())
+	{
+		animated_ranges[range].moved = true;
+	}
+}
+
+// Brings the baked triangles, the BVHs and the triangle buffer up to date with the
+// transforms set since the last call. Only the moved ranges are touched before the
+// BVH refit, which is one pass over the nodes.
+bool Scene::refit()
+{
+	STATS_TIMER(build);
+	int num_triangles = triangles.size();
+	bool moved = false;
+	for(unsigned int k = 0; k < animated_ranges.size(); ++k)
+	{
+		AnimatedRange &range = animated_ranges[k];
+		if(!range.moved)
+		{
+			continue;
+		}
+		// Baked from the rest copy every time, so no error builds up over the frames and
+		// a transform that collapsed the geometry for a while does not lose it
+		int transform_id = animated_transforms[k];
+		const mat4 &transform = transforms[transform_id];
+		for(int i = range.first_triangle; i < range.first_triangle + range.triangle_count; ++i)
+		{
+			triangles[i] = rest_triangles[i];
+			triangles[i].toWorldSpace(transform, inversed_transforms[transform_id]);
+			primitive_bounds[i] = triangles[i].bounds(transform);
+			triangle_buffer.update(primitive_slots[i], triangles[i]);
+		}
+		for(int i = range.first_sphere; i < range.first_sphere + range.sphere_count; ++i)
+		{
+			primitive_bounds[num_triangles + i] = spheres[i].bounds(transform);
+		}
+		range.moved = false;
+		moved = true;
+	}
+	if(!moved)
+	{
+		return false;
+	}
+
+	bvh.refit(primitive_bounds);
+	if(rebuild_threshold > 0.0f && bvh.cost() > rebuild_threshold * built_cost)
+	{
+		unique_ptr<ThreadPool> pool(build_threads > 1 ? new ThreadPool(build_threads) : NULL);
+		bvh.build(primitive_bounds, bvh_quality, pool.get());
+		buildFromBVH();
+		return true;
+	}
+	if(traversal == wide)
+	{
+		bvh8.refit(bvh);
+	}
+	return false;
+}
+
+// Cost, triangle buffer and wide BVH follow every build of bvh. Animated scenes also
+// record the slot of every primitive, where refit updates its moved triangles.
+void Scene::buildFromBVH()
+{
+	built_cost = bvh.cost();
+	triangle_buffer.build(primitives, bvh.indices);
+	if(traversal == wide)
+	{
+		bvh8.build(bvh);
+	}
+	if(animated)
+	{
+		primitive_slots.resize(primitives.size());
+		for(unsigned int slot = 0; slot < bvh.indices.size(); ++slot)
+		{
+			primitive_slots[bvh.indices[slot]] = slot;
+		}
+	}
+}
+
+void Object::buildPrimitiveView()
+{
+	primitives = PrimitiveView(triangles, spheres);
+}
+
+void Scene::buildPrimitiveView()
+{
+	primitives = PrimitiveView(triangles, spheres);
 }
 
 Scene::Scene()
 {
+	// Entry 0 is the identity, used by geometry baked into world space
+	addTransform(mat4(1.0));
 	attenuation[0] = 1.0;
 	attenuation[1] = 0.0;
 	attenuation[2] = 0.0;
 	max_depth = 5;
+	min_throughput = 0.0f;
+	bvh_quality = BVH::sah;
+	build_threads = 1;
+	traversal = binary;
+	animated = false;
+	rebuild_threshold = 1.5f;
+	built_cost = 0.0f;
 }
-
-Scene::~Scene() {}
@@ -5,9 +5,13 @@
 #define SCENE_H
 
 #include <vector>
+#include <string>
 #include <stack>
-#include <sstream>
+#include <unordered_map>
 #include "primitives.h"
+#include "bvh.h"
+#include "bvh8.h"
+#include "trianglebuffer.h"
 
 using namespace std;
 
@@ -25,6 +29,20 @@ struct Camera
 	Camera() : eye(0.0, 0.0, 5.0), center(0.0, 0.0, 0.0), up(0.0, 1.0, 0.0) {}
 };
 
+// Adaptive supersampling settings. Every pixel gets base_samples rays; pixels whose
+// samples or neighbours differ in brightness by more than threshold get more, up to
+// max_samples. With max_samples of 1 the single ray goes through the pixel corner.
+struct Antialiasing
+{
+	int base_samples;
+	int max_samples;
+	float threshold;
+
+	Antialiasing() : base_samples(1), max_samples(1), threshold(0.05f) {}
+
+	bool enabled() const { return max_samples > 1; }
+};
+
 struct Light
 {
 	vec3 pos_or_dir;
@@ -39,29 +57,154 @@ struct Light
 	const vec3 &direction() const;
 };
 
+// Geometry defined once between beginObject and endObject, in its own coordinate
+// frame and with its own BVH. Instances place it in the world without copying it.
+struct Object
+{
+	vector<Triangle> triangles;
+	vector<Sphere> spheres;
+	PrimitiveView primitives;
+	BVH bvh;
+	TriangleBuffer triangle_buffer;
+
+	// Distinct transforms of the primitives within the object, and the position of each
+	// primitive's transform in that list
+	vector<int> transform_ids;
+	vector<int> transform_slots;
+
+	bool empty() const { return triangles.empty() && spheres.empty(); }
+	void buildPrimitiveView();
+};
+
+// One placement of an object. Rays enter the object's frame through transform_id, and
+// a hit primitive is shaded with instance_transforms[first_transform + slot], its own
+// transform followed by the instance's.
+struct Instance
+{
+	int object;
+	int transform_id;
+	int first_transform;
+};
+
+// The run of the primitive arena that one transform of an animated scene places, and
+// whether the transform was set since the last refit
+struct AnimatedRange
+{
+	int first_triangle, triangle_count;
+	int first_sphere, sphere_count;
+	bool moved;
+};
+
 struct Scene
 {
 private:
-	bool readvals (stringstream &s, const int numvals, float *values);
+	bool readvals (const char *&cursor, const char *end, const int numvals, float *values);
+	void assignState(Primitive &primitive, const mat4 &transform, bool top_level, int &material_id, int &transform_id);
+	int addMaterial(const Materials &state);
+	int addTransform(const mat4 &transform);
+	int appendTransform(const mat4 &transform);
+	int animatedRange(int transform_id) const;
+	void findAnimatedRanges();
+	void buildPrimitiveView();
+	void buildFromBVH();
+
+	unordered_map<Materials, int, MaterialsHash> material_ids;
+	unordered_map<mat4, int, Mat4BitsHash, Mat4BitsEqual> transform_ids;
+	unordered_map<string, int> object_ids;
+
+	// Animation state: the top level triangles as parsed, in the frame of their
+	// transform, the range of every entry of animated_transforms, the bounds and triangle
+	// buffer slot of every primitive and the SAH cost of the last build of bvh
+	vector<Triangle> rest_triangles;
+	vector<AnimatedRange> animated_ranges;
+	vector<AABB> primitive_bounds;
+	vector<int> primitive_slots;
+	float built_cost;
 
 public:
 	Scene();
 
+	// readFile is parse, which reads the commands of a scene file into the scene state,
+	// followed by finalize, which bakes the geometry and builds the BVHs
 	void readFile(const string &filename);
+	void parse(const string &filename);
+	void finalize();
+
+	// Upper bound on the direct light one hit can reflect, INFINITY when the
+	// attenuation leaves point lights unbounded
+	float maxRadiance() const;
+
+	// Binary cache of the fully resolved scene, see scenecache.cpp. readCompiled
+	// returns false if the file is not a compiled scene.
+	void writeCompiled(const string &filename) const;
+	bool readCompiled(const string &filename);
 	string outputfile;
 
 	Camera camera;
 
 	int max_depth;
 
+	// Reflection paths stop once their weight drops below min_throughput. The default
+	// of 0 follows every reflection up to max_depth.
+	float min_throughput;
+
 	int width, height;
 
+	Antialiasing antialiasing;
+
 	vector<Light> lights;
 
 	Materials materials;
 	float attenuation[3];
 
-	vector<Primitive*> primitives;
+	// Primitive arena. Geometry is stored by value grouped by shape and refers to
+	// materials and transforms by index. primitives numbers it for the BVH once
+	// finalize has read the whole file.
+	vector<Triangle> triangles;
+	vector<Sphere> spheres;
+	vector<Materials> material_table;
+	vector<mat4> transforms, inversed_transforms;
+	PrimitiveView primitives;
+	BVH bvh;
+	TriangleBuffer triangle_buffer;
+
+	// Two level instancing: a top level BVH over the world bounds of the instances,
+	// traversed after bvh, and one shared BVH per object
+	vector<Object> objects;
+	vector<Instance> instances;
+	vector<int> instance_transforms;
+	BVH instance_bvh;
+
+	// How finalize builds the BVH, set before readFile. build_threads of 1 builds on the
+	// calling thread.
+	BVH::Quality bvh_quality;
+	int build_threads;
+
+	// Backend of RayTracer::getIntersection and occluded over bvh: the binary BVH itself,
+	// or bvh8 collapsed from it when set to wide before the scene is loaded
+	enum Traversal {binary, wide};
+	Traversal traversal;
+	BVH8 bvh8;
+
+	// Animation, set animated before readFile. Every transform state geometry outside of
+	// objects is created under then gets its own entry, listed in file order in
+	// animated_transforms, instead of sharing identical matrices. Move them with
+	// setTransform and call refit before rendering the frame: the triangles of the moved
+	// transforms are baked again from their rest copy, only their bounds and triangle
+	// buffer slots are updated, and bvh and bvh8 are refitted in place. bvh is rebuilt
+	// instead once its SAH cost exceeds rebuild_threshold times that of its last build
+	// (0 never rebuilds). refit returns true if it rebuilt. Objects and instances are not
+	// animated: instances never share an entry with the geometry, so setTransform does
+	// not move them.
+	bool animated;
+	float rebuild_threshold;
+	vector<int> animated_transforms;
+	void setTransform(int transform_id, const mat4 &transform);
+	bool refit();
+
+	const Materials &material(const Primitive *primitive) const { return material_table[primitive->material_id]; }
+	const mat4 &transform(const Primitive *primitive) const { return transforms[primitive->transform_id]; }
+	const mat4 &inversedTransform(const Primitive *primitive) const { return inversed_transforms[primitive->transform_id]; }
 
 	vector<vec3> vertex_buffer, vertex_buffer_with_normal, vertex_normal_buffer;
 };
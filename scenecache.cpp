@@ -0,0 +1,338 @@
+// Scene cache cpp file that writes and loads fully resolved scenes in a binary format
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include "scene.h"
+#include "mappedfile.h"
+
+// A compiled scene is a header followed by one section per array. Every section is a
+// 64 bit element count and the raw elements, padded to 16 bytes, so loading is a
+// bounds check and one copy per array: no parsing, transform evaluation, matrix
+// inversion or BVH build. The header records the layout of every stored struct and
+// files written by a build with a different layout are rejected.
+namespace
+{
+	const char magic[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+	const unsigned int version = 4;
+	const size_t alignment = 16;
+
+	struct Header
+	{
+		char magic[8];
+		unsigned int version;
+		unsigned int layout[9];
+		Camera camera;
+		int max_depth;
+		int width, height;
+		Antialiasing antialiasing;
+		float attenuation[3];
+	};
+
+	void describeLayout(unsigned int *layout)
+	{
+		layout[0] = sizeof(Camera);
+		layout[1] = sizeof(Light);
+		layout[2] = sizeof(Materials);
+		layout[3] = sizeof(mat4);
+		layout[4] = sizeof(Triangle);
+		layout[5] = sizeof(Sphere);
+		layout[6] = sizeof(BVH::Node);
+		layout[7] = sizeof(Header);
+		layout[8] = sizeof(Instance);
+	}
+
+	void writePadding(ofstream &out)
+	{
+		static const char zeros[alignment] = {0};
+		size_t position = out.tellp();
+		out.write(zeros, (alignment - position % alignment) % alignment);
+	}
+
+	template <typename T>
+	void writeSection(ofstream &out, const T *data, size_t count)
+	{
+		unsigned long long count64 = count;
+		out.write(reinterpret_cast<const char*>(&count64), sizeof(count64));
+		writePadding(out);
+		if(count > 0)
+		{
+			out.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+		}
+		writePadding(out);
+	}
+
+	// Every material and transform a primitive refers to is in the tables
+	template <typename T>
+	bool validReferences(const vector<T> &primitives, size_t num_materials, size_t num_transforms)
+	{
+		for(unsigned int i = 0; i < primitives.size(); ++i)
+		{
+			if(primitives[i].material_id < 0 || (size_t)primitives[i].material_id >= num_materials
+				|| primitives[i].transform_id < 0 || (size_t)primitives[i].transform_id >= num_transforms)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Every entry is a valid index into a table of the given size
+	bool validIndices(const vector<int> &indices, size_t size)
+	{
+		for(unsigned int i = 0; i < indices.size(); ++i)
+		{
+			if(indices[i] < 0 || (size_t)indices[i] >= size)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool validObject(const Object &object, size_t num_materials, size_t num_transforms)
+	{
+		size_t num_primitives = object.triangles.size() + object.spheres.size();
+		return validReferences(object.triangles, num_materials, num_transforms)
+			&& validReferences(object.spheres, num_materials, num_transforms)
+			&& object.bvh.valid(num_primitives)
+			&& validIndices(object.transform_ids, num_transforms)
+			&& object.transform_slots.size() == num_primitives
+			&& validIndices(object.transform_slots, object.transform_ids.size());
+	}
+
+	// Each instance names an object, a transform and a run of composed transforms that
+	// has one entry per transform of the object
+	bool validInstances(const vector<Instance> &instances, const vector<Object> &objects, const vector<int> &instance_transforms, size_t num_transforms)
+	{
+		for(unsigned int k = 0; k < instances.size(); ++k)
+		{
+			const Instance &instance = instances[k];
+			if(instance.object < 0 || (size_t)instance.object >= objects.size()
+				|| instance.transform_id < 0 || (size_t)instance.transform_id >= num_transforms
+				|| instance.first_transform < 0
+				|| (size_t)instance.first_transform + objects[instance.object].transform_ids.size() > instance_transforms.size())
+			{
+				return false;
+			}
+		}
+		return validIndices(instance_transforms, num_transforms);
+	}
+
+	// Animated transforms are listed once each in increasing order, and every triangle
+	// of an animated scene has a rest copy
+	bool validAnimation(const vector<int> &animated_transforms, const vector<Triangle> &rest_triangles, size_t num_triangles, size_t num_materials, size_t num_transforms)
+	{
+		for(unsigned int k = 0; k < animated_transforms.size(); ++k)
+		{
+			if(animated_transforms[k] < 0 || (size_t)animated_transforms[k] >= num_transforms
+				|| (k > 0 && animated_transforms[k] <= animated_transforms[k - 1]))
+			{
+				return false;
+			}
+		}
+		return rest_triangles.size() == (animated_transforms.empty() ? 0 : num_triangles)
+			&& validReferences(rest_triangles, num_materials, num_transforms);
+	}
+
+	const char *alignCursor(const char *begin, const char *cursor)
+	{
+		size_t offset = cursor - begin;
+		return cursor + (alignment - offset % alignment) % alignment;
+	}
+
+	template <typename T>
+	bool readSection(const char *begin, const char *end, const char *&cursor, vector<T> &out)
+	{
+		unsigned long long count;
+		if((size_t)(end - cursor) < sizeof(count))
+		{
+			return false;
+		}
+		memcpy(&count, cursor, sizeof(count));
+		cursor = alignCursor(begin, cursor + sizeof(count));
+		if(cursor > end || count > (unsigned long long)(end - cursor) / sizeof(T))
+		{
+			return false;
+		}
+		const T *data = reinterpret_cast<const T*>(cursor);
+		out.assign(data, data + count);
+		cursor = alignCursor(begin, cursor + count * sizeof(T));
+		return cursor <= end;
+	}
+}
+
+void Scene::writeCompiled(const string &filename) const
+{
+	ofstream out(filename.c_str(), ios::binary | ios::trunc);
+	if(!out.is_open())
+	{
+		cerr << "Unable to Open Output File " << filename << "\n";
+		throw 2;
+	}
+
+	Header header = Header();
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	describeLayout(header.layout);
+	header.camera = camera;
+	header.max_depth = max_depth;
+	header.width = width;
+	header.height = height;
+	header.antialiasing = antialiasing;
+	memcpy(header.attenuation, attenuation, sizeof(attenuation));
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	writePadding(out);
+
+	writeSection(out, outputfile.data(), outputfile.size());
+	writeSection(out, lights.data(), lights.size());
+	writeSection(out, material_table.data(), material_table.size());
+	writeSection(out, transforms.data(), transforms.size());
+	writeSection(out, inversed_transforms.data(), inversed_transforms.size());
+	writeSection(out, triangles.data(), triangles.size());
+	writeSection(out, spheres.data(), spheres.size());
+	writeSection(out, bvh.nodes.data(), bvh.nodes.size());
+	writeSection(out, bvh.indices.data(), bvh.indices.size());
+
+	// Objects keep their own arrays, preceded by how many there are
+	int num_objects = objects.size();
+	writeSection(out, &num_objects, 1);
+	for(unsigned int k = 0; k < objects.size(); ++k)
+	{
+		const Object &object = objects[k];
+		writeSection(out, object.triangles.data(), object.triangles.size());
+		writeSection(out, object.spheres.data(), object.spheres.size());
+		writeSection(out, object.bvh.nodes.data(), object.bvh.nodes.size());
+		writeSection(out, object.bvh.indices.data(), object.bvh.indices.size());
+		writeSection(out, object.transform_ids.data(), object.transform_ids.size());
+		writeSection(out, object.transform_slots.data(), object.transform_slots.size());
+	}
+	writeSection(out, instances.data(), instances.size());
+	writeSection(out, instance_transforms.data(), instance_transforms.size());
+	writeSection(out, instance_bvh.nodes.data(), instance_bvh.nodes.size());
+	writeSection(out, instance_bvh.indices.data(), instance_bvh.indices.size());
+
+	// Empty unless the scene was loaded for animation
+	writeSection(out, rest_triangles.data(), rest_triangles.size());
+	writeSection(out, animated_transforms.data(), animated_transforms.size());
+
+	if(!out)
+	{
+		cerr << "Failed writing compiled scene " << filename << "\n";
+		throw 2;
+	}
+}
+
+bool Scene::readCompiled(const string &filename)
+{
+	MappedFile file;
+	if(!file.open(filename) || file.size() < sizeof(Header) || memcmp(file.data(), magic, sizeof(magic)) != 0)
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, file.data(), sizeof(header));
+	unsigned int layout[9];
+	describeLayout(layout);
+	if(header.version != version || memcmp(header.layout, layout, sizeof(layout)) != 0)
+	{
+		cerr << "Compiled scene " << filename << " was written by an incompatible build, recompile it\n";
+		throw 2;
+	}
+	camera = header.camera;
+	max_depth = header.max_depth;
+	width = header.width;
+	height = header.height;
+	antialiasing = header.antialiasing;
+	memcpy(attenuation, header.attenuation, sizeof(attenuation));
+
+	const char *begin = file.data();
+	const char *end = begin + file.size();
+	const char *cursor = alignCursor(begin, begin + sizeof(header));
+	vector<char> name;
+	bool valid = readSection(begin, end, cursor, name)
+		&& readSection(begin, end, cursor, lights)
+		&& readSection(begin, end, cursor, material_table)
+		&& readSection(begin, end, cursor, transforms)
+		&& readSection(begin, end, cursor, inversed_transforms)
+		&& readSection(begin, end, cursor, triangles)
+		&& readSection(begin, end, cursor, spheres)
+		&& readSection(begin, end, cursor, bvh.nodes)
+		&& readSection(begin, end, cursor, bvh.indices);
+	// Each object takes six sections of at least alignment bytes, which bounds the count
+	// before any object is allocated
+	vector<int> num_objects;
+	valid = valid && readSection(begin, end, cursor, num_objects) && num_objects.size() == 1
+		&& num_objects[0] >= 0 && (size_t)num_objects[0] <= (size_t)(end - cursor) / (6 * alignment);
+	if(valid)
+	{
+		objects.resize(num_objects[0]);
+	}
+	for(unsigned int k = 0; valid && k < objects.size(); ++k)
+	{
+		Object &object = objects[k];
+		valid = readSection(begin, end, cursor, object.triangles)
+			&& readSection(begin, end, cursor, object.spheres)
+			&& readSection(begin, end, cursor, object.bvh.nodes)
+			&& readSection(begin, end, cursor, object.bvh.indices)
+			&& readSection(begin, end, cursor, object.transform_ids)
+			&& readSection(begin, end, cursor, object.transform_slots);
+	}
+	valid = valid
+		&& readSection(begin, end, cursor, instances)
+		&& readSection(begin, end, cursor, instance_transforms)
+		&& readSection(begin, end, cursor, instance_bvh.nodes)
+		&& readSection(begin, end, cursor, instance_bvh.indices)
+		&& readSection(begin, end, cursor, rest_triangles)
+		&& readSection(begin, end, cursor, animated_transforms);
+	// The renderer indexes with what the file says, so a reference out of range is as
+	// fatal as a truncated section
+	valid = valid
+		&& inversed_transforms.size() == transforms.size()
+		&& validReferences(triangles, material_table.size(), transforms.size())
+		&& validReferences(spheres, material_table.size(), transforms.size())
+		&& bvh.valid(triangles.size() + spheres.size());
+	for(unsigned int k = 0; valid && k < objects.size(); ++k)
+	{
+		valid = validObject(objects[k], material_table.size(), transforms.size());
+	}
+	valid = valid
+		&& validInstances(instances, objects, instance_transforms, transforms.size())
+		&& instance_bvh.empty() == instances.empty()
+		&& instance_bvh.valid(instances.size())
+		&& validAnimation(animated_transforms, rest_triangles, triangles.size(), material_table.size(), transforms.size());
+	if(!valid)
+	{
+		cerr << "Compiled scene " << filename << " is truncated or corrupt\n";
+		throw 2;
+	}
+	// The triangles of a static scene are baked with no way back to their transforms
+	if(animated && animated_transforms.empty() && !(triangles.empty() && spheres.empty()))
+	{
+		cerr << "Compiled scene " << filename << " was not compiled for animation, recompile it\n";
+		throw 2;
+	}
+	animated = !animated_transforms.empty();
+	outputfile.assign(name.begin(), name.end());
+
+	buildPrimitiveView();
+	if(animated)
+	{
+		findAnimatedRanges();
+		primitive_bounds.resize(primitives.size());
+		for(unsigned int i = 0; i < primitives.size(); ++i)
+		{
+			primitive_bounds[i] = primitives[i]->bounds(transform(primitives[i]));
+		}
+	}
+	buildFromBVH();
+	for(unsigned int k = 0; k < objects.size(); ++k)
+	{
+		objects[k].buildPrimitiveView();
+		objects[k].triangle_buffer.build(objects[k].primitives, objects[k].bvh.indices);
+	}
+	return true;
+}
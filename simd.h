@@ -0,0 +1,73 @@
+// SIMD header file that declares a 4 wide float type for ray packets
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef SIMD_H
+#define SIMD_H
+
+// float4 holds one value per packet lane and mask4 one flag per lane. They map onto
+// SSE registers when available and onto plain arrays elsewhere, so packet code is
+// written once.
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+struct float4 { __m128 v; };
+struct mask4 { __m128 v; };
+
+inline float4 set1(float x) { float4 r = {_mm_set1_ps(x)}; return r; }
+inline float4 load4(const float *p) { float4 r = {_mm_loadu_ps(p)}; return r; }
+inline void store4(float *p, float4 a) { _mm_storeu_ps(p, a.v); }
+inline float4 operator + (float4 a, float4 b) { float4 r = {_mm_add_ps(a.v, b.v)}; return r; }
+inline float4 operator - (float4 a, float4 b) { float4 r = {_mm_sub_ps(a.v, b.v)}; return r; }
+inline float4 operator * (float4 a, float4 b) { float4 r = {_mm_mul_ps(a.v, b.v)}; return r; }
+inline float4 operator / (float4 a, float4 b) { float4 r = {_mm_div_ps(a.v, b.v)}; return r; }
+inline float4 min4(float4 a, float4 b) { float4 r = {_mm_min_ps(a.v, b.v)}; return r; }
+inline float4 max4(float4 a, float4 b) { float4 r = {_mm_max_ps(a.v, b.v)}; return r; }
+inline float4 abs4(float4 a) { float4 r = {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; return r; }
+inline mask4 operator < (float4 a, float4 b) { mask4 r = {_mm_cmplt_ps(a.v, b.v)}; return r; }
+inline mask4 operator <= (float4 a, float4 b) { mask4 r = {_mm_cmple_ps(a.v, b.v)}; return r; }
+inline mask4 operator >= (float4 a, float4 b) { mask4 r = {_mm_cmpge_ps(a.v, b.v)}; return r; }
+inline mask4 operator & (mask4 a, mask4 b) { mask4 r = {_mm_and_ps(a.v, b.v)}; return r; }
+inline mask4 maskFromBits(int bits)
+{
+	mask4 r = {_mm_castsi128_ps(_mm_setr_epi32(bits & 1 ? -1 : 0, bits & 2 ? -1 : 0, bits & 4 ? -1 : 0, bits & 8 ? -1 : 0))};
+	return r;
+}
+inline int bits(mask4 m) { return _mm_movemask_ps(m.v); }
+inline float4 select(mask4 m, float4 a, float4 b) { float4 r = {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))}; return r; }
+
+#else
+
+#include <cmath>
+#include <algorithm>
+
+struct float4 { float v[4]; };
+struct mask4 { bool v[4]; };
+
+#define FLOAT4_OP(expr) float4 r; for(int k = 0; k < 4; ++k) { r.v[k] = (expr); } return r;
+#define MASK4_OP(expr) mask4 r; for(int k = 0; k < 4; ++k) { r.v[k] = (expr); } return r;
+
+inline float4 set1(float x) { FLOAT4_OP(x) }
+inline float4 load4(const float *p) { FLOAT4_OP(p[k]) }
+inline void store4(float *p, float4 a) { for(int k = 0; k < 4; ++k) { p[k] = a.v[k]; } }
+inline float4 operator + (float4 a, float4 b) { FLOAT4_OP(a.v[k] + b.v[k]) }
+inline float4 operator - (float4 a, float4 b) { FLOAT4_OP(a.v[k] - b.v[k]) }
+inline float4 operator * (float4 a, float4 b) { FLOAT4_OP(a.v[k] * b.v[k]) }
+inline float4 operator / (float4 a, float4 b) { FLOAT4_OP(a.v[k] / b.v[k]) }
+inline float4 min4(float4 a, float4 b) { FLOAT4_OP(std::min(a.v[k], b.v[k])) }
+inline float4 max4(float4 a, float4 b) { FLOAT4_OP(std::max(a.v[k], b.v[k])) }
+inline float4 abs4(float4 a) { FLOAT4_OP(fabs(a.v[k])) }
+inline mask4 operator < (float4 a, float4 b) { MASK4_OP(a.v[k] < b.v[k]) }
+inline mask4 operator <= (float4 a, float4 b) { MASK4_OP(a.v[k] <= b.v[k]) }
+inline mask4 operator >= (float4 a, float4 b) { MASK4_OP(a.v[k] >= b.v[k]) }
+inline mask4 operator & (mask4 a, mask4 b) { MASK4_OP(a.v[k] && b.v[k]) }
+inline mask4 maskFromBits(int bits) { MASK4_OP((bits >> k & 1) != 0) }
+inline int bits(mask4 m) { int r = 0; for(int k = 0; k < 4; ++k) { r |= m.v[k] << k; } return r; }
+inline float4 select(mask4 m, float4 a, float4 b) { FLOAT4_OP(m.v[k] ? a.v[k] : b.v[k]) }
+
+#undef FLOAT4_OP
+#undef MASK4_OP
+
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+// Stats cpp file that defines the optional hot path instrumentation counters
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <mutex>
+#include <vector>
+#include "stats.h"
+
+namespace
+{
+	const char *stage_names[Stats::num_stages] = {"parse", "build", "render", "intersect", "shadow", "shading"};
+
+	// Blocks of every thread that ever counted. They are never freed, so the counts of
+	// pool threads that have exited still show up in the report.
+	mutex registry_lock;
+	vector<Stats*> registry;
+
+	Stats *registerThread()
+	{
+		Stats *stats = new Stats();
+		lock_guard<mutex> guard(registry_lock);
+		registry.push_back(stats);
+		return stats;
+	}
+}
+
+Stats::Stats() : primary_rays(0), shadow_rays(0), reflection_rays(0), primitive_tests(0), node_visits(0)
+{
+	for(int k = 0; k < num_stages; ++k)
+	{
+		stage_calls[k] = 0;
+		stage_samples[k] = 0;
+		stage_nanoseconds[k] = 0;
+	}
+}
+
+double Stats::stageMilliseconds(int stage) const
+{
+	if(stage_samples[stage] == 0)
+	{
+		return 0.0;
+	}
+	return stage_nanoseconds[stage] * 1e-6 * stage_calls[stage] / stage_samples[stage];
+}
+
+Stats &Stats::local()
+{
+	thread_local Stats *stats = registerThread();
+	return *stats;
+}
+
+Stats Stats::total()
+{
+	Stats sum;
+	lock_guard<mutex> guard(registry_lock);
+	for(unsigned int i = 0; i < registry.size(); ++i)
+	{
+		const Stats &stats = *registry[i];
+		sum.primary_rays += stats.primary_rays;
+		sum.shadow_rays += stats.shadow_rays;
+		sum.reflection_rays += stats.reflection_rays;
+		sum.primitive_tests += stats.primitive_tests;
+		sum.node_visits += stats.node_visits;
+		for(int k = 0; k < num_stages; ++k)
+		{
+			sum.stage_calls[k] += stats.stage_calls[k];
+			sum.stage_samples[k] += stats.stage_samples[k];
+			sum.stage_nanoseconds[k] += stats.stage_nanoseconds[k];
+		}
+	}
+	return sum;
+}
+
+bool Stats::enabled()
+{
+#ifdef RT_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Stage times are summed over threads, so the parallel stages can exceed wall time.
+// Per ray stages are estimates from the sampled calls.
+void Stats::report(ostream &out, bool json)
+{
+	if(!enabled())
+	{
+		out << "Statistics are not compiled in, rebuild with make STATS=1\n";
+		return;
+	}
+	Stats sum = total();
+	uint64_t rays = sum.primary_rays + sum.shadow_rays + sum.reflection_rays;
+	double per_ray = rays > 0 ? 1.0 / rays : 0.0;
+	if(json)
+	{
+		out << "{\"primary_rays\": " << sum.primary_rays << ", \"shadow_rays\": " << sum.shadow_rays
+			<< ", \"reflection_rays\": " << sum.reflection_rays << ", \"primitive_tests\": " << sum.primitive_tests
+			<< ", \"node_visits\": " << sum.node_visits << ", \"stage_ms\": {";
+		for(int k = 0; k < num_stages; ++k)
+		{
+			out << (k > 0 ? ", " : "") << "\"" << stage_names[k] << "\": " << sum.stageMilliseconds(k);
+		}
+		out << "}}\n";
+		return;
+	}
+	out << "Rays: " << rays << " (primary " << sum.primary_rays << ", shadow " << sum.shadow_rays
+		<< ", reflection " << sum.reflection_rays << ")\n";
+	out << "Primitive tests: " << sum.primitive_tests << " (" << sum.primitive_tests * per_ray << " per ray)\n";
+	out << "Node visits: " << sum.node_visits << " (" << sum.node_visits * per_ray << " per ray)\n";
+	for(int k = 0; k < num_stages; ++k)
+	{
+		out << "Time " << stage_names[k] << ": " << sum.stageMilliseconds(k) << " ms\n";
+	}
+}
@@ -0,0 +1,85 @@
+// Stats header file that declares the optional hot path instrumentation counters
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+
+using namespace std;
+
+// Ray, traversal and timing counters for sizing hardware and checking BVH quality.
+// Each thread counts into its own block, so counting never takes a lock. The counting
+// macros below only do anything when built with -DRT_STATS (make STATS=1); otherwise
+// they expand to nothing and the hot paths are unchanged.
+struct Stats
+{
+	// Stages from intersect on run once per ray. Reading the clock on every call would
+	// cost as much as the work being timed, so only one call in sampling is timed and
+	// the report scales the sampled time up to all calls.
+	enum Stage {parse, build, render, intersect, shadow, shading, num_stages};
+	static const int sampling = 64;
+
+	uint64_t primary_rays, shadow_rays, reflection_rays;
+	uint64_t primitive_tests, node_visits;
+	uint64_t stage_calls[num_stages], stage_samples[num_stages];
+	uint64_t stage_nanoseconds[num_stages];
+
+	// Estimated total time of a stage in milliseconds
+	double stageMilliseconds(int stage) const;
+
+	Stats();
+
+	// Counters of the calling thread, registered for the report on first use
+	static Stats &local();
+
+	// Sum over every thread that has counted so far. Only exact once rendering is done.
+	static Stats total();
+
+	// Human readable summary, or a single JSON object
+	static void report(ostream &out, bool json);
+
+	static bool enabled();
+};
+
+// Adds the time between construction and destruction to one stage of this thread
+class StageTimer
+{
+public:
+	explicit StageTimer(Stats::Stage stage_) : stats(Stats::local()), stage(stage_)
+	{
+		sampled = stage < Stats::intersect || stats.stage_calls[stage] % Stats::sampling == 0;
+		++stats.stage_calls[stage];
+		if(sampled)
+		{
+			start = chrono::steady_clock::now();
+		}
+	}
+
+	~StageTimer()
+	{
+		if(sampled)
+		{
+			++stats.stage_samples[stage];
+			stats.stage_nanoseconds[stage] += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+		}
+	}
+
+private:
+	Stats &stats;
+	Stats::Stage stage;
+	bool sampled;
+	chrono::steady_clock::time_point start;
+};
+
+#ifdef RT_STATS
+#define STATS_COUNT(counter, n) (Stats::local().counter += (n))
+#define STATS_TIMER(stage) StageTimer stage_timer_(Stats::stage)
+#else
+#define STATS_COUNT(counter, n) ((void)0)
+#define STATS_TIMER(stage) ((void)0)
+#endif
+
+#endif
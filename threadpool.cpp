@@ -0,0 +1,124 @@
+// Thread pool cpp file that defines the work stealing pool used by the renderer
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int num_threads) : body(nullptr), remaining(0), generation(0), stopping(false)
+{
+	if(num_threads < 1)
+	{
+		num_threads = 1;
+	}
+	for(int i = 0; i < num_threads; ++i)
+	{
+		workers.push_back(new Worker());
+	}
+	for(int i = 0; i < num_threads; ++i)
+	{
+		threads.push_back(thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> guard(state_lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(unsigned int i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+	for(unsigned int i = 0; i < workers.size(); ++i)
+	{
+		delete workers[i];
+	}
+}
+
+int ThreadPool::defaultThreadCount()
+{
+	int count = thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+void ThreadPool::parallelFor(int num_tasks, const function<void(int)> &body_)
+{
+	if(num_tasks <= 0)
+	{
+		return;
+	}
+	unique_lock<mutex> guard(state_lock);
+	body = &body_;
+	remaining = num_tasks;
+	int num_workers = workers.size();
+	for(int w = 0; w < num_workers; ++w)
+	{
+		lock_guard<mutex> worker_guard(workers[w]->lock);
+		for(int task = num_tasks * w / num_workers; task < num_tasks * (w + 1) / num_workers; ++task)
+		{
+			workers[w]->tasks.push_back(task);
+		}
+	}
+	++generation;
+	wake.notify_all();
+	done.wait(guard, [this] { return remaining == 0; });
+	body = nullptr;
+}
+
+// Own queue is consumed from the front so neighbouring tiles stay on one core,
+// thieves take from the back of the other queues.
+bool ThreadPool::popTask(int id, int *task)
+{
+	{
+		Worker *self = workers[id];
+		lock_guard<mutex> guard(self->lock);
+		if(!self->tasks.empty())
+		{
+			*task = self->tasks.front();
+			self->tasks.pop_front();
+			return true;
+		}
+	}
+	int num_workers = workers.size();
+	for(int k = 1; k < num_workers; ++k)
+	{
+		Worker *victim = workers[(id + k) % num_workers];
+		lock_guard<mutex> guard(victim->lock);
+		if(!victim->tasks.empty())
+		{
+			*task = victim->tasks.back();
+			victim->tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(int id)
+{
+	int seen_generation = 0;
+	while(true)
+	{
+		{
+			unique_lock<mutex> guard(state_lock);
+			wake.wait(guard, [&] { return stopping || generation != seen_generation; });
+			if(stopping)
+			{
+				return;
+			}
+			seen_generation = generation;
+		}
+		int task;
+		while(popTask(id, &task))
+		{
+			(*body)(task);
+			if(--remaining == 0)
+			{
+				lock_guard<mutex> guard(state_lock);
+				done.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,52 @@
+// Thread pool header file that declares the work stealing pool used by the renderer
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+using namespace std;
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(int num_threads);
+	~ThreadPool();
+
+	int size() const { return threads.size(); }
+
+	// Runs body(task) for every task in [0, num_tasks) and blocks until all of them finish.
+	// Tasks are dealt out in contiguous chunks, idle workers steal from the back of other queues.
+	void parallelFor(int num_tasks, const function<void(int)> &body);
+
+	static int defaultThreadCount();
+
+private:
+	struct Worker
+	{
+		mutex lock;
+		deque<int> tasks;
+	};
+
+	void workerLoop(int id);
+	bool popTask(int id, int *task);
+
+	vector<thread> threads;
+	vector<Worker*> workers;
+
+	mutex state_lock;
+	condition_variable wake, done;
+	const function<void(int)> *body;
+	atomic<int> remaining;
+	int generation;
+	bool stopping;
+};
+
+#endif
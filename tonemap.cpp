@@ -0,0 +1,27 @@
+// Tone mapping cpp file that defines the HDR to display post pass
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <cmath>
+#include <algorithm>
+#include "tonemap.h"
+
+Color ToneMapping::apply(const Color &color) const
+{
+	Color scaled = color * exp2(exposure);
+	if(op == reinhard)
+	{
+		return Color(scaled.r / (1.0f + scaled.r), scaled.g / (1.0f + scaled.g), scaled.b / (1.0f + scaled.b));
+	}
+	return Color(std::min(scaled.r, 1.0f), std::min(scaled.g, 1.0f), std::min(scaled.b, 1.0f));
+}
+
+Framebuffer ToneMapping::apply(const Framebuffer &framebuffer) const
+{
+	Framebuffer mapped(framebuffer.width, framebuffer.height);
+	for(unsigned int k = 0; k < framebuffer.pixels.size(); ++k)
+	{
+		mapped.pixels[k] = apply(framebuffer.pixels[k]);
+	}
+	return mapped;
+}
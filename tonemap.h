@@ -0,0 +1,26 @@
+// Tone mapping header file that declares the HDR to display post pass
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+#include "framebuffer.h"
+
+// Maps scene radiance to display values in [0, 1]. Runs on a finished framebuffer, so the
+// float image can be kept and developed again with other settings without re-rendering.
+struct ToneMapping
+{
+	// clamp cuts everything above 1 like the original 8 bit output, reinhard compresses
+	// highlights with c / (1 + c)
+	enum Operator {clamp, reinhard};
+
+	Operator op;
+	float exposure; // In stops, each stop doubles the radiance before mapping
+
+	ToneMapping() : op(clamp), exposure(0.0f) {}
+
+	Color apply(const Color &color) const;
+	Framebuffer apply(const Framebuffer &framebuffer) const;
+};
+
+#endif
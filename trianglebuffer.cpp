@@ -0,0 +1,274 @@
+// Triangle buffer cpp file that defines the packed triangle storage and the SIMD intersection kernel
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include <cmath>
+#include "trianglebuffer.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Same tolerances as Triangle::intersect
+	const float min_t = 1e-2f;
+	const int padding = 8;
+}
+
+void TriangleBuffer::build(const PrimitiveView &primitives, const vector<int> &order)
+{
+	int size = order.size() + padding;
+	vector<float>* arrays[9] = {&v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z};
+	for(int k = 0; k < 9; ++k)
+	{
+		arrays[k]->assign(size, 0.0f);
+	}
+
+	for(unsigned int slot = 0; slot < order.size(); ++slot)
+	{
+		if(primitives.isSphere(order[slot]))
+		{
+			continue;
+		}
+		update(slot, primitives.triangles[order[slot]]);
+	}
+}
+
+void TriangleBuffer::update(int slot, const Triangle &triangle)
+{
+	vec3 e1 = triangle.vertexes[1] - triangle.vertexes[0];
+	vec3 e2 = triangle.vertexes[2] - triangle.vertexes[0];
+	v0x[slot] = triangle.vertexes[0].x;
+	v0y[slot] = triangle.vertexes[0].y;
+	v0z[slot] = triangle.vertexes[0].z;
+	e1x[slot] = e1.x;
+	e1y[slot] = e1.y;
+	e1z[slot] = e1.z;
+	e2x[slot] = e2.x;
+	e2y[slot] = e2.y;
+	e2z[slot] = e2.z;
+}
+
+#if defined(__AVX__)
+
+namespace
+{
+	const int width = 8;
+	typedef __m256 vfloat;
+	inline vfloat vset(float x) { return _mm256_set1_ps(x); }
+	inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+	inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+	inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+	inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+	inline vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+	inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+	inline vfloat vandnot(vfloat a, vfloat b) { return _mm256_andnot_ps(a, b); }
+	inline vfloat vor(vfloat a, vfloat b) { return _mm256_or_ps(a, b); }
+	inline vfloat vlt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline vfloat vge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	inline vfloat vle(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline int vmask(vfloat a) { return _mm256_movemask_ps(a); }
+	inline void vstore(float *p, vfloat a) { _mm256_storeu_ps(p, a); }
+	inline vfloat vlanes() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+}
+
+#elif defined(__SSE2__)
+
+namespace
+{
+	const int width = 4;
+	typedef __m128 vfloat;
+	inline vfloat vset(float x) { return _mm_set1_ps(x); }
+	inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+	inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+	inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+	inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+	inline vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+	inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+	inline vfloat vandnot(vfloat a, vfloat b) { return _mm_andnot_ps(a, b); }
+	inline vfloat vor(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+	inline vfloat vlt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+	inline vfloat vge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+	inline vfloat vle(vfloat a, vfloat b) { return _mm_cmple_ps(a, b); }
+	inline int vmask(vfloat a) { return _mm_movemask_ps(a); }
+	inline void vstore(float *p, vfloat a) { _mm_storeu_ps(p, a); }
+	inline vfloat vlanes() { return _mm_setr_ps(0, 1, 2, 3); }
+}
+
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__)
+
+namespace
+{
+	// Moller-Trumbore on width triangles starting at slot k. Lanes past end are masked out.
+	// Returns the lane mask of hits with min_t <= t < t_max, and their parameters in t.
+	inline vfloat intersectPacket(const Ray &ray, int k, int end, float t_max, const float *const *arrays, vfloat *t)
+	{
+		vfloat dx = vset(ray.direction.x), dy = vset(ray.direction.y), dz = vset(ray.direction.z);
+		vfloat e1x = vload(arrays[3] + k), e1y = vload(arrays[4] + k), e1z = vload(arrays[5] + k);
+		vfloat e2x = vload(arrays[6] + k), e2y = vload(arrays[7] + k), e2z = vload(arrays[8] + k);
+
+		vfloat px = vsub(vmul(dy, e2z), vmul(dz, e2y));
+		vfloat py = vsub(vmul(dz, e2x), vmul(dx, e2z));
+		vfloat pz = vsub(vmul(dx, e2y), vmul(dy, e2x));
+		vfloat det = vadd(vadd(vmul(e1x, px), vmul(e1y, py)), vmul(e1z, pz));
+		vfloat abs_det = vandnot(vset(-0.0f), det);
+		vfloat inv_det = vdiv(vset(1.0f), det);
+
+		vfloat tx = vsub(vset(ray.o.x), vload(arrays[0] + k));
+		vfloat ty = vsub(vset(ray.o.y), vload(arrays[1] + k));
+		vfloat tz = vsub(vset(ray.o.z), vload(arrays[2] + k));
+		vfloat u = vmul(vadd(vadd(vmul(tx, px), vmul(ty, py)), vmul(tz, pz)), inv_det);
+
+		vfloat qx = vsub(vmul(ty, e1z), vmul(tz, e1y));
+		vfloat qy = vsub(vmul(tz, e1x), vmul(tx, e1z));
+		vfloat qz = vsub(vmul(tx, e1y), vmul(ty, e1x));
+		vfloat v = vmul(vadd(vadd(vmul(dx, qx), vmul(dy, qy)), vmul(dz, qz)), inv_det);
+		*t = vmul(vadd(vadd(vmul(e2x, qx), vmul(e2y, qy)), vmul(e2z, qz)), inv_det);
+
+		vfloat mask = vlt(vadd(vset((float)(k - end)), vlanes()), vset(0.0f));
+		mask = vand(mask, vlt(vset(eps), abs_det));
+		mask = vand(mask, vge(u, vset(-eps)));
+		mask = vand(mask, vge(v, vset(-eps)));
+		mask = vand(mask, vle(vadd(u, v), vset(1.0f + eps)));
+		mask = vand(mask, vge(*t, vset(min_t)));
+		mask = vand(mask, vlt(*t, vset(t_max)));
+		return mask;
+	}
+}
+
+bool TriangleBuffer::intersect(const Ray &ray, int first, int count, float *t_max, int *slot) const
+{
+	const float *arrays[9] = {&v0x[0], &v0y[0], &v0z[0], &e1x[0], &e1y[0], &e1z[0], &e2x[0], &e2y[0], &e2z[0]};
+	bool hit = false;
+	int end = first + count;
+	for(int k = first; k < end; k += width)
+	{
+		vfloat t;
+		vfloat mask = intersectPacket(ray, k, end, *t_max, arrays, &t);
+		int bits = vmask(mask);
+		if(bits == 0)
+		{
+			continue;
+		}
+		float lanes[width];
+		vstore(lanes, t);
+		for(int lane = 0; lane < width; ++lane)
+		{
+			if((bits >> lane & 1) && lanes[lane] < *t_max)
+			{
+				*t_max = lanes[lane];
+				*slot = k + lane;
+				hit = true;
+			}
+		}
+	}
+	return hit;
+}
+
+bool TriangleBuffer::occluded(const Ray &ray, int first, int count, float t_max) const
+{
+	const float *arrays[9] = {&v0x[0], &v0y[0], &v0z[0], &e1x[0], &e1y[0], &e1z[0], &e2x[0], &e2y[0], &e2z[0]};
+	int end = first + count;
+	for(int k = first; k < end; k += width)
+	{
+		vfloat t;
+		if(vmask(intersectPacket(ray, k, end, t_max, arrays, &t)) != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+#else
+
+bool TriangleBuffer::intersect(const Ray &ray, int first, int count, float *t_max, int *slot) const
+{
+	bool hit = false;
+	for(int k = first; k < first + count; ++k)
+	{
+		vec3 e1(e1x[k], e1y[k], e1z[k]), e2(e2x[k], e2y[k], e2z[k]);
+		vec3 p = glm::cross(ray.direction, e2);
+		float det = glm::dot(e1, p);
+		if(fabs(det) <= eps)
+		{
+			continue;
+		}
+		float inv_det = 1.0f / det;
+		vec3 tvec = ray.o - vec3(v0x[k], v0y[k], v0z[k]);
+		float u = glm::dot(tvec, p) * inv_det;
+		vec3 q = glm::cross(tvec, e1);
+		float v = glm::dot(ray.direction, q) * inv_det;
+		float t = glm::dot(e2, q) * inv_det;
+		if(u >= -eps && v >= -eps && u + v <= 1.0f + eps && t >= min_t && t < *t_max)
+		{
+			*t_max = t;
+			*slot = k;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+bool TriangleBuffer::occluded(const Ray &ray, int first, int count, float t_max) const
+{
+	int slot;
+	return intersect(ray, first, count, &t_max, &slot);
+}
+
+#endif
+
+// One triangle against the four rays of a packet per iteration, with the triangle
+// broadcast across the lanes. Same arithmetic and tolerances as the kernels above.
+void TriangleBuffer::intersect(const RayPacket &packet, int first, int count, float *t_max, int *slots) const
+{
+	float4 ox = load4(packet.ox), oy = load4(packet.oy), oz = load4(packet.oz);
+	float4 dx = load4(packet.dx), dy = load4(packet.dy), dz = load4(packet.dz);
+	float4 t_best = load4(t_max);
+	mask4 active = maskFromBits(packet.active);
+	for(int k = first; k < first + count; ++k)
+	{
+		float4 e1x_ = set1(e1x[k]), e1y_ = set1(e1y[k]), e1z_ = set1(e1z[k]);
+		float4 e2x_ = set1(e2x[k]), e2y_ = set1(e2y[k]), e2z_ = set1(e2z[k]);
+
+		float4 px = dy * e2z_ - dz * e2y_;
+		float4 py = dz * e2x_ - dx * e2z_;
+		float4 pz = dx * e2y_ - dy * e2x_;
+		float4 det = e1x_ * px + e1y_ * py + e1z_ * pz;
+		float4 inv_det = set1(1.0f) / det;
+
+		float4 tx = ox - set1(v0x[k]);
+		float4 ty = oy - set1(v0y[k]);
+		float4 tz = oz - set1(v0z[k]);
+		float4 u = (tx * px + ty * py + tz * pz) * inv_det;
+
+		float4 qx = ty * e1z_ - tz * e1y_;
+		float4 qy = tz * e1x_ - tx * e1z_;
+		float4 qz = tx * e1y_ - ty * e1x_;
+		float4 v = (dx * qx + dy * qy + dz * qz) * inv_det;
+		float4 t = (e2x_ * qx + e2y_ * qy + e2z_ * qz) * inv_det;
+
+		mask4 mask = active & (set1(eps) < abs4(det));
+		mask = mask & (u >= set1(-eps)) & (v >= set1(-eps)) & (u + v <= set1(1.0f + eps));
+		mask = mask & (t >= set1(min_t)) & (t < t_best);
+		int hits = bits(mask);
+		if(hits == 0)
+		{
+			continue;
+		}
+		t_best = select(mask, t, t_best);
+		for(int lane = 0; lane < RayPacket::size; ++lane)
+		{
+			if(hits >> lane & 1)
+			{
+				slots[lane] = k;
+			}
+		}
+	}
+	store4(t_max, t_best);
+}
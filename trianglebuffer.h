@@ -0,0 +1,44 @@
+// Triangle buffer header file that declares the packed structure of arrays triangle storage
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef TRIANGLEBUFFER_H
+#define TRIANGLEBUFFER_H
+
+#include <vector>
+#include "primitives.h"
+#include "packet.h"
+
+using namespace std;
+
+// World space triangles laid out as separate x/y/z arrays of the first vertex and the
+// two edges, in the same slot order as the BVH primitive references. finalize bakes
+// every triangle, so the slots of spheres are the only ones left degenerate, and
+// they never report a hit.
+// The kernel tests 8 triangles at once when built with AVX (-mavx2), 4 with SSE2,
+// and falls back to a scalar loop elsewhere.
+class TriangleBuffer
+{
+public:
+	void build(const PrimitiveView &primitives, const vector<int> &order);
+
+	// Replaces the baked triangle in slot after it moved
+	void update(int slot, const Triangle &triangle);
+
+	// Nearest triangle in slots [first, first + count) hit at a ray parameter below *t_max.
+	// On a hit *t_max is lowered to the hit parameter and *slot is set.
+	bool intersect(const Ray &ray, int first, int count, float *t_max, int *slot) const;
+
+	// True if any triangle in slots [first, first + count) is hit below t_max
+	bool occluded(const Ray &ray, int first, int count, float t_max) const;
+
+	// Tests every triangle in slots [first, first + count) against all active lanes of
+	// the packet. Per lane t_max and slots work like the single ray version.
+	void intersect(const RayPacket &packet, int first, int count, float *t_max, int *slots) const;
+
+private:
+	vector<float> v0x, v0y, v0z;
+	vector<float> e1x, e1y, e1z;
+	vector<float> e2x, e2y, e2z;
+};
+
+#endif
@@ -0,0 +1,160 @@
+// Wavefront cpp file that defines the breadth first tile tracer
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+
+#include "wavefront.h"
+
+#if defined(RT_WAVEFRONT)
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	// Spreads the low 10 bits of x so that there are two zero bits between each
+	inline uint64_t spreadBits(uint64_t x)
+	{
+		x &= 0x3ff;
+		x = (x | x << 16) & 0x30000ff;
+		x = (x | x << 8) & 0x300f00f;
+		x = (x | x << 4) & 0x30c30c3;
+		x = (x | x << 2) & 0x9249249;
+		return x;
+	}
+
+	// Direction octant in the top bits and the Morton code of the origin inside the
+	// scene bounds below, so sorting groups rays that leave the same region the same way
+	uint64_t rayKey(const Ray &ray, const AABB &bounds)
+	{
+		uint64_t octant = (ray.direction.x < 0) | (ray.direction.y < 0) << 1 | (ray.direction.z < 0) << 2;
+		vec3 extent = glm::max(bounds.hi - bounds.lo, vec3(1e-6f));
+		vec3 cell = glm::clamp((ray.o - bounds.lo) / extent, 0.0f, 1.0f) * 1023.0f;
+		uint64_t morton = spreadBits((uint64_t)cell.x) | spreadBits((uint64_t)cell.y) << 1 | spreadBits((uint64_t)cell.z) << 2;
+		return octant << 30 | morton;
+	}
+
+	template<typename T> bool byKey(const T &a, const T &b) { return a.key < b.key; }
+}
+
+void WavefrontTracer::renderTile(const Scene &scene, const CameraModel &camera, const Tile &tile, vector<Color> &pixels)
+{
+	bounds = AABB();
+	if(!scene.bvh.empty())
+	{
+		bounds = scene.bvh.nodes[0].box;
+	}
+	if(!scene.instance_bvh.empty())
+	{
+		bounds.expand(scene.instance_bvh.nodes[0].box);
+	}
+	paths.clear();
+	for(int i = tile.y0; i < tile.y1; ++i)
+	{
+		vec3 direction = camera.rowStart(i) + camera.column_step * (float)tile.x0;
+		for(int j = tile.x0; j < tile.x1; ++j, direction += camera.column_step)
+		{
+			Path path = {Ray(camera.eye, direction), WHITE, tile.index(i, j), 0};
+			paths.push_back(path);
+		}
+	}
+
+	STATS_COUNT(primary_rays, paths.size());
+
+	// Primary rays are coherent already, later bounces are sorted before they are traced
+	for(int depth = 0; depth <= scene.max_depth && !paths.empty(); ++depth)
+	{
+		intersectPaths(scene);
+		traceShadows(scene);
+		accumulate(scene, pixels, depth);
+		std::sort(next_paths.begin(), next_paths.end(), byKey<Path>);
+		paths.swap(next_paths);
+	}
+}
+
+void WavefrontTracer::intersectPaths(const Scene &scene)
+{
+	hits.clear();
+	tracer.clearInstanceHits();
+	for(unsigned int k = 0; k < paths.size(); ++k)
+	{
+		Hit hit;
+		hit.path = k;
+		if(tracer.getIntersection(paths[k].ray, scene, hit.primitive, &hit.point))
+		{
+			hits.push_back(hit);
+		}
+	}
+}
+
+// One shadow ray per hit and light, built the same way as RayTracer::directLight
+void WavefrontTracer::traceShadows(const Scene &scene)
+{
+	int num_lights = scene.lights.size();
+	shadows.clear();
+	for(unsigned int k = 0; k < hits.size(); ++k)
+	{
+		for(int light = 0; light < num_lights; ++light)
+		{
+			ShadowRay shadow = {Ray(hits[k].point, vec3(0.0f)), std::numeric_limits<float>::infinity(), (int)k, light, 0};
+			if(scene.lights[light].type == Light::point)
+			{
+				vec3 to_light = scene.lights[light].position() - hits[k].point;
+				shadow.max_dist = glm::length(to_light);
+				shadow.ray.direction = to_light / shadow.max_dist;
+			}
+			else
+			{
+				shadow.ray.direction = glm::normalize(scene.lights[light].direction());
+			}
+			shadow.key = (uint64_t)light << 33 | rayKey(shadow.ray, bounds);
+			shadows.push_back(shadow);
+		}
+	}
+	std::sort(shadows.begin(), shadows.end(), byKey<ShadowRay>);
+
+	// Terms are stored per hit and light so they can be summed in light order afterwards
+	light_terms.assign(hits.size() * num_lights, BLACK);
+	for(unsigned int k = 0; k < shadows.size(); ++k)
+	{
+		const ShadowRay &shadow = shadows[k];
+		if(tracer.occluded(shadow.ray, shadow.max_dist, scene))
+		{
+			continue;
+		}
+		const Hit &hit = hits[shadow.hit];
+		STATS_TIMER(shading);
+		light_terms[shadow.hit * num_lights + shadow.light] = tracer.calcLight(scene.lights[shadow.light], hit.primitive, scene, paths[hit.path].ray, hit.point, scene.attenuation);
+	}
+}
+
+// Adds the direct light of every hit to its pixel and queues the reflection rays
+void WavefrontTracer::accumulate(const Scene &scene, vector<Color> &pixels, int depth)
+{
+	int num_lights = scene.lights.size();
+	next_paths.clear();
+	for(unsigned int k = 0; k < hits.size(); ++k)
+	{
+		const Hit &hit = hits[k];
+		const Path &path = paths[hit.path];
+		const Materials &materials = scene.material(hit.primitive);
+		Color color(materials.ambient + materials.emission);
+		for(int light = 0; light < num_lights; ++light)
+		{
+			color = color + light_terms[k * num_lights + light];
+		}
+		pixels[path.pixel] = pixels[path.pixel] + path.throughput * color;
+
+		Color throughput = path.throughput * materials.specular;
+		if(depth + 1 > scene.max_depth || throughput.maxComponent() < scene.min_throughput)
+		{
+			continue;
+		}
+		vec3 unit_normal = glm::normalize(hit.primitive->interpolatePointNormal(hit.point, scene.inversedTransform(hit.primitive)));
+		Path reflected = {tracer.createReflectRay(path.ray, hit.point, unit_normal), throughput, path.pixel, 0};
+		reflected.key = rayKey(reflected.ray, bounds);
+		next_paths.push_back(reflected);
+		STATS_COUNT(reflection_rays, 1);
+	}
+}
+
+#endif
@@ -0,0 +1,62 @@
+// Wavefront header file that declares the breadth first tile tracer
+// Author: Sasidharan Mahalingam
+// Date Created: 17 Oct 2026
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <vector>
+#include <cstdint>
+#include "raytracer.h"
+#include "framebuffer.h"
+
+using namespace std;
+
+// Traces a tile one bounce at a time instead of one pixel at a time. All rays of a
+// bounce are intersected together, then their shadow rays and reflection rays are
+// collected into queues, sorted so that rays with similar directions and origins are
+// adjacent, and streamed through the BVH. Produces the same image as RayTracer::shade.
+class WavefrontTracer
+{
+public:
+	// Adds the radiance of every pixel of the tile into pixels, a buffer covering just the tile
+	void renderTile(const Scene &scene, const CameraModel &camera, const Tile &tile, vector<Color> &pixels);
+
+private:
+	// A ray still carrying weight towards one pixel
+	struct Path
+	{
+		Ray ray;
+		Color throughput;
+		int pixel;
+		uint64_t key;
+	};
+
+	struct Hit
+	{
+		int path;
+		const Primitive *primitive;
+		vec3 point;
+	};
+
+	struct ShadowRay
+	{
+		Ray ray;
+		float max_dist;
+		int hit;
+		int light;
+		uint64_t key;
+	};
+
+	void intersectPaths(const Scene &scene);
+	void traceShadows(const Scene &scene);
+	void accumulate(const Scene &scene, vector<Color> &pixels, int depth);
+
+	RayTracer tracer;
+	vector<Path> paths, next_paths;
+	vector<Hit> hits;
+	vector<ShadowRay> shadows;
+	vector<Color> light_terms;
+	AABB bounds;
+};
+
+#endif